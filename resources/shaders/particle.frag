@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 Local;
+in vec4 Color;
+
+void main()
+{
+    // Soft round dot inside the quad
+    float falloff = 1.0 - smoothstep(0.25, 0.5, length(Local));
+    FragColor = vec4(Color.rgb, Color.a * falloff);
+}
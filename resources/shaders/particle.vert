@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec2 aCorner;
+// Per instance, each read from its own region of the instance buffer
+layout (location = 1) in float aX;
+layout (location = 2) in float aY;
+layout (location = 3) in float aFade;
+layout (location = 4) in vec4 aColor;
+
+out vec2 Local;
+out vec4 Color;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
+uniform float size;
+uniform float depth;
+
+void main()
+{
+    gl_Position = projection * view * vec4(aX + aCorner.x * size, aY + aCorner.y * size, depth, 1.0);
+    Local = aCorner;
+    Color = vec4(aColor.rgb, aColor.a * aFade);
+}
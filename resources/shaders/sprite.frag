@@ -1,12 +0,0 @@
-#version 330 core
-out vec4 FragColor;
-  
-in vec2 TexCoord;
-
-uniform sampler2D ourTexture;
-
-void main()
-{
-    FragColor = texture(ourTexture, TexCoord);
-    // FragColor = vec4(TexCoord, 0.0, 1.0);
-}
\ No newline at end of file
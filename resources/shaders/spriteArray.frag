@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+  
+in vec3 TexCoord;
+
+uniform sampler2DArray sprites;
+// Debug view, every shaded fragment adds the same colour so heavily overdrawn areas glow
+uniform bool overdraw;
+
+void main()
+{
+    if (overdraw) {
+        FragColor = vec4(0.12, 0.06, 0.02, 1.0);
+        return;
+    }
+    FragColor = texture(sprites, TexCoord);
+}
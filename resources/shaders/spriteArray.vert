@@ -0,0 +1,29 @@
+#version 330 core
+// Per instance
+layout (location = 2) in uint aSprite;
+
+out vec3 TexCoord;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
+// Five texels per sprite: the model matrix columns, then the layer in x
+uniform samplerBuffer transforms;
+// Eight uv space hull corners per texture array layer, drawn as a fan
+uniform samplerBuffer hulls;
+
+void main()
+{
+    int base = int(aSprite) * 5;
+    mat4 model = mat4(
+        texelFetch(transforms, base),
+        texelFetch(transforms, base + 1),
+        texelFetch(transforms, base + 2),
+        texelFetch(transforms, base + 3)
+    );
+    float layer = texelFetch(transforms, base + 4).x;
+    vec2 corner = texelFetch(hulls, int(layer) * 8 + gl_VertexID).xy;
+    gl_Position = projection * view * model * vec4(corner - 0.5, 0.0, 1.0);
+    TexCoord = vec3(corner, layer);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+// Baked static sprites, positions are already in world space
+layout (location = 0) in vec3 aPos;
+// Layer in z
+layout (location = 1) in vec3 aTexCoord;
+
+out vec3 TexCoord;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+};
+
+void main()
+{
+    gl_Position = projection * view * vec4(aPos, 1.0);
+    TexCoord = aTexCoord;
+}
@@ -5,9 +5,17 @@ in vec2 TexCoord;
 
 uniform sampler2D ourTexture;
 uniform vec4 color;
+uniform bool distanceField;
 
 void main()
 {
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(ourTexture, TexCoord).r);
+    float value = texture(ourTexture, TexCoord).r;
+    float alpha = value;
+    if (distanceField) {
+        // The outline sits at 0.5, fwidth keeps the edge one screen pixel wide at any scale
+        float edgeWidth = fwidth(value);
+        alpha = smoothstep(0.5 - edgeWidth, 0.5 + edgeWidth, value);
+    }
+    vec4 sampled = vec4(1.0, 1.0, 1.0, alpha);
     FragColor = vec4(1.0, 0.0, 0.0, 1.0) * sampled;
-}
\ No newline at end of file
+}
@@ -1,7 +1,163 @@
 #include "camera.h"
 #include "window.h"
+#include <algorithm>
 
-void PerspectiveCamera::updateProjectionMatrix(const Window& window) {
-	float aspectRatio = (float)window.Width / (float)window.Height;
-	projection = glm::ortho(-aspectRatio, aspectRatio, 1.0f, -1.0f, -1000.0f, 1000.0f);
-}
\ No newline at end of file
+// Matches the std140 Camera block in the shaders, two mat4s need no padding
+struct CameraBlock {
+	glm::mat4 projection;
+	glm::mat4 view;
+};
+
+Camera::~Camera() {
+	if (uniformBuffer != 0)
+		glDeleteBuffers(1, &uniformBuffer);
+}
+
+void Camera::updateView() {
+	if (viewBuilt && position == viewPosition && rotation == viewRotation)
+		return;
+	viewBuilt = true;
+	viewPosition = position;
+	viewRotation = rotation;
+	glm::mat4 world = glm::translate(glm::mat4(1.0f), position);
+	world = glm::rotate(world, rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
+	world = glm::rotate(world, rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
+	world = glm::rotate(world, rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+	setView(glm::inverse(world));
+}
+
+void Camera::updateProjectionMatrix(glm::vec2 targetSize) {
+	glm::vec2 size(targetSize.x * viewport.z, targetSize.y * viewport.w);
+	glm::vec4 parameters = projectionParameters();
+	if (projectionBuilt && size == viewportSize && zoom == projectionZoom && parameters == builtParameters)
+		return;
+	projectionBuilt = true;
+	viewportSize = size;
+	projectionZoom = zoom;
+	builtParameters = parameters;
+	setProjection(buildProjection(size.x / std::max(size.y, 1.0f)));
+}
+
+void Camera::updateProjectionMatrix(const Window& window) {
+	updateProjectionMatrix(glm::vec2(window.Width, window.Height));
+}
+
+void Camera::applyViewport(glm::vec2 targetSize) const {
+	GLint x = GLint(viewport.x * targetSize.x);
+	GLint y = GLint(viewport.y * targetSize.y);
+	GLsizei width = GLsizei(viewport.z * targetSize.x);
+	GLsizei height = GLsizei(viewport.w * targetSize.y);
+	glViewport(x, y, width, height);
+	glScissor(x, y, width, height);
+}
+
+void Camera::setView(const glm::mat4& matrix) {
+	if (matrix != view) {
+		view = matrix;
+		version++;
+	}
+}
+
+void Camera::setProjection(const glm::mat4& matrix) {
+	if (matrix != projection) {
+		projection = matrix;
+		version++;
+	}
+}
+
+void Camera::refreshCache() {
+	if (cachedVersion == version)
+		return;
+	cachedViewProjection = projection * view;
+	cachedInverse = glm::inverse(cachedViewProjection);
+	// Gribb-Hartmann planes, each row combined with the w row, normals pointing inwards
+	auto& m = cachedViewProjection;
+	auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+	for (int axis = 0; axis < 3; axis++) {
+		glm::vec4 w = row(3), r = row(axis);
+		frustum[axis * 2] = glm::vec4(w.x + r.x, w.y + r.y, w.z + r.z, w.w + r.w);
+		frustum[axis * 2 + 1] = glm::vec4(w.x - r.x, w.y - r.y, w.z - r.z, w.w - r.w);
+	}
+	cachedVersion = version;
+}
+
+const glm::mat4& Camera::viewProjection() {
+	refreshCache();
+	return cachedViewProjection;
+}
+
+const glm::mat4& Camera::inverseViewProjection() {
+	refreshCache();
+	return cachedInverse;
+}
+
+glm::vec3 Camera::screenToWorld(glm::vec2 screen, float depth) {
+	glm::vec4 ndc(screen.x / viewportSize.x * 2.0f - 1.0f, 1.0f - screen.y / viewportSize.y * 2.0f, depth, 1.0f);
+	glm::vec4 world = inverseViewProjection() * ndc;
+	return glm::vec3(world.x / world.w, world.y / world.w, world.z / world.w);
+}
+
+glm::vec2 Camera::worldToScreen(glm::vec3 world) {
+	glm::vec4 clip = viewProjection() * glm::vec4(world, 1.0f);
+	glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+	return glm::vec2((ndc.x + 1.0f) * 0.5f * viewportSize.x, (1.0f - ndc.y) * 0.5f * viewportSize.y);
+}
+
+glm::vec3 Camera::screenToPlane(glm::vec2 screen, float z) {
+	glm::vec3 near = screenToWorld(screen, -1.0f);
+	glm::vec3 far = screenToWorld(screen, 1.0f);
+	// Orthographic cameras looking straight down have every ray parallel to the z axis
+	if (far.z == near.z)
+		return glm::vec3(near.x, near.y, z);
+	float t = (z - near.z) / (far.z - near.z);
+	return near + (far - near) * t;
+}
+
+bool Camera::isVisible(glm::vec3 min, glm::vec3 max) {
+	refreshCache();
+	for (auto& plane : frustum) {
+		// Corner furthest along the plane normal
+		float x = plane.x >= 0.0f ? max.x : min.x;
+		float y = plane.y >= 0.0f ? max.y : min.y;
+		float z = plane.z >= 0.0f ? max.z : min.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+void Camera::use() {
+	if (uniformBuffer == 0) {
+		glGenBuffers(1, &uniformBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (uploadedVersion != version) {
+		CameraBlock block{ projection, view };
+		glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		uploadedVersion = version;
+	}
+	glBindBufferBase(GL_UNIFORM_BUFFER, UniformBlock::Camera, uniformBuffer);
+}
+
+glm::vec4 OrthographicCamera::projectionParameters() const {
+	return glm::vec4(height, nearPlane, farPlane, 0.0f);
+}
+
+glm::mat4 OrthographicCamera::buildProjection(float aspectRatio) const {
+	float halfHeight = height * 0.5f / zoom;
+	float halfWidth = halfHeight * aspectRatio;
+	return glm::ortho(-halfWidth, halfWidth, halfHeight, -halfHeight, nearPlane, farPlane);
+}
+
+glm::vec4 PerspectiveCamera::projectionParameters() const {
+	return glm::vec4(fieldOfView, nearPlane, farPlane, 0.0f);
+}
+
+glm::mat4 PerspectiveCamera::buildProjection(float aspectRatio) const {
+	glm::mat4 projection = glm::perspective(fieldOfView / zoom, aspectRatio, nearPlane, farPlane);
+	projection[1][1] = -projection[1][1];
+	return projection;
+}
@@ -1,24 +1,94 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 #include "shader.h"
 class Window;
 
 struct Camera {
 	glm::vec3 position = { 0.0f, 0.0f, 1.0f };
+	// Euler angles in radians applied roll, pitch then yaw
+	glm::vec3 rotation = { 0.0f, 0.0f, 0.0f };
+	// Above 1 magnifies
+	float zoom = 1.0f;
+	// Part of the render target drawn to, normalized x and y from the bottom left then width and height
+	glm::vec4 viewport = { 0.0f, 0.0f, 1.0f, 1.0f };
 	glm::mat4 projection = glm::mat4(1.0f);
 	glm::mat4 view = glm::mat4(1.0f);
+	// Size in pixels of the viewport the projection was last built for
+	glm::vec2 viewportSize = { 1.0f, 1.0f };
+	// Bumped whenever projection or view change, anything derived from the camera can key on it
+	std::uint64_t version = 1;
 
-	virtual void updateProjectionMatrix(const Window& w) = 0;
+	Camera() = default;
+	Camera(const Camera&) = delete;
+	Camera& operator=(const Camera&) = delete;
+	virtual ~Camera();
 
-	void updateView() {
-		view = glm::translate(glm::mat4(1.0f), position);
-	}
+	// Rebuilds the projection for a render target of targetSize pixels if anything it depends on changed
+	void updateProjectionMatrix(glm::vec2 targetSize);
+	void updateProjectionMatrix(const Window& w);
+	// Rebuilds the view only if position or rotation changed since the last call
+	void updateView();
+	// Points glViewport and glScissor at this camera's part of a render target
+	void applyViewport(glm::vec2 targetSize) const;
 
-	void applyToShader(ShaderProgram& p) {
-		p.setUniformMat4("projection", projection)->setUniformMat4("view", view);
-	}
+	const glm::mat4& viewProjection();
+	const glm::mat4& inverseViewProjection();
+	// Viewport pixels, origin top left, to world space at the given normalized device depth
+	glm::vec3 screenToWorld(glm::vec2 screen, float depth = 0.0f);
+	glm::vec2 worldToScreen(glm::vec3 world);
+	// Where the ray through a viewport pixel crosses the world plane at height z, for any projection
+	glm::vec3 screenToPlane(glm::vec2 screen, float z);
+	// Whether any of a world space box is inside the view frustum
+	bool isVisible(glm::vec3 min, glm::vec3 max);
+
+	// Binds the matrices to the Camera uniform block, uploading them first if they changed.
+	// Call once per pass rather than per draw.
+	void use();
+protected:
+	// Everything besides aspect ratio and zoom the projection is built from, compared to skip rebuilds
+	virtual glm::vec4 projectionParameters() const = 0;
+	virtual glm::mat4 buildProjection(float aspectRatio) const = 0;
+	void setView(const glm::mat4& matrix);
+	void setProjection(const glm::mat4& matrix);
+private:
+	unsigned int uniformBuffer = 0;
+	std::uint64_t uploadedVersion = 0;
+	std::uint64_t cachedVersion = 0;
+	glm::mat4 cachedViewProjection = glm::mat4(1.0f);
+	glm::mat4 cachedInverse = glm::mat4(1.0f);
+	std::array<glm::vec4, 6> frustum;
+	bool viewBuilt = false;
+	glm::vec3 viewPosition;
+	glm::vec3 viewRotation;
+	bool projectionBuilt = false;
+	float projectionZoom = 1.0f;
+	glm::vec4 builtParameters;
+	void refreshCache();
+};
+
+// Y grows downwards, matching screen space
+struct OrthographicCamera : public Camera {
+	// World units visible vertically at zoom 1
+	float height = 2.0f;
+	float nearPlane = -1000.0f;
+	float farPlane = 1000.0f;
+protected:
+	glm::vec4 projectionParameters() const override;
+	glm::mat4 buildProjection(float aspectRatio) const override;
 };
 
+// Y grows downwards as with OrthographicCamera, so clockwise world geometry stays front facing under both
 struct PerspectiveCamera : public Camera {
-	virtual void updateProjectionMatrix(const Window& window) override;
-};
\ No newline at end of file
+	// Vertical field of view in radians at zoom 1
+	float fieldOfView = 1.0471976f;
+	float nearPlane = 0.1f;
+	float farPlane = 1000.0f;
+protected:
+	glm::vec4 projectionParameters() const override;
+	glm::mat4 buildProjection(float aspectRatio) const override;
+};
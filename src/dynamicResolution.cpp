@@ -0,0 +1,84 @@
+#include "dynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(RenderTargetPool& p) : pool(p) {
+	glGenQueries(queryCount, queries.data());
+}
+
+DynamicResolution::~DynamicResolution() {
+	glDeleteQueries(queryCount, queries.data());
+}
+
+void DynamicResolution::collectTimings() {
+	// Results arrive a few frames late, read them oldest first without waiting on any
+	for (int i = 0; i < queryCount; i++) {
+		int query = (nextQuery + i) % queryCount;
+		if (!pendingQueries[query])
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[query], GL_QUERY_RESULT, &nanoseconds);
+		pendingQueries[query] = false;
+		double milliseconds = nanoseconds / 1.0e6;
+		smoothedMilliseconds = smoothedMilliseconds == 0.0 ? milliseconds : smoothedMilliseconds * 0.9 + milliseconds * 0.1;
+	}
+}
+
+void DynamicResolution::adapt() {
+	if (smoothedMilliseconds == 0.0)
+		return;
+	// Leave some slack below the budget so the scale doesn't flip every frame
+	if (smoothedMilliseconds < budgetMilliseconds * 1.05 && smoothedMilliseconds > budgetMilliseconds * 0.8)
+		return;
+	// Fill cost grows with the pixel count, the square of the scale. Timings lag behind changes so
+	// only part of the way is taken each frame.
+	float ideal = scale * float(std::sqrt(budgetMilliseconds / smoothedMilliseconds));
+	scale = std::clamp(scale + (ideal - scale) * 0.25f, minScale, maxScale);
+}
+
+glm::vec2 DynamicResolution::begin(int width, int height) {
+	collectTimings();
+	if (adaptive)
+		adapt();
+	scale = std::clamp(scale, minScale, maxScale);
+
+	offscreen = adaptive || scale != 1.0f;
+	if (offscreen) {
+		if (!scene || scene->screenScale != maxScale)
+			scene = pool.acquireScreen(maxScale);
+		sceneSize = glm::ivec2(
+			std::clamp(int(std::lround(width * scale)), 1, scene->width),
+			std::clamp(int(std::lround(height * scale)), 1, scene->height)
+		);
+		scene->bind();
+		glViewport(0, 0, sceneSize.x, sceneSize.y);
+	}
+	else {
+		// Hand the target back to the pool, it's freed if fixed full scale stays on
+		scene.reset();
+		sceneSize = glm::ivec2(width, height);
+		RenderTarget::bindDefault(width, height);
+	}
+
+	// With every query still in flight this frame goes unmeasured
+	timing = !pendingQueries[nextQuery];
+	if (timing)
+		glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+	return glm::vec2(sceneSize.x, sceneSize.y);
+}
+
+void DynamicResolution::end(int width, int height) {
+	if (timing) {
+		glEndQuery(GL_TIME_ELAPSED);
+		pendingQueries[nextQuery] = true;
+		nextQuery = (nextQuery + 1) % queryCount;
+		timing = false;
+	}
+	if (offscreen)
+		scene->blitRegion(sceneSize.x, sceneSize.y, nullptr, width, height, GL_LINEAR);
+	RenderTarget::bindDefault(width, height);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <glad/glad.h>
+#include <array>
+#include <memory>
+#include <glm/vec2.hpp>
+
+#include "renderTarget.h"
+
+// Renders the scene at a fraction of the framebuffer size and upscales it, so fill cost no longer
+// follows the window size. The scale is either fixed or, when adaptive, steered towards a GPU frame
+// time budget measured with timer queries. The offscreen target is allocated once at maxScale and
+// lower scales only use its bottom left corner, so changing the scale never reallocates.
+// Anything drawn after end, like text, stays at native resolution.
+class DynamicResolution {
+	static constexpr int queryCount = 4;
+	RenderTargetPool& pool;
+	std::shared_ptr<RenderTarget> scene;
+	std::array<GLuint, queryCount> queries{};
+	std::array<bool, queryCount> pendingQueries{};
+	int nextQuery = 0;
+	bool timing = false;
+	bool offscreen = false;
+	glm::ivec2 sceneSize;
+	double smoothedMilliseconds = 0.0;
+
+	void collectTimings();
+	void adapt();
+public:
+	// Fraction of the framebuffer size the scene is rendered at
+	float scale = 1.0f;
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+	bool adaptive = false;
+	// GPU time the scene pass should fit in when adaptive
+	double budgetMilliseconds = 12.0;
+
+	DynamicResolution(RenderTargetPool& pool);
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+	~DynamicResolution();
+
+	// Binds the scene target for a framebuffer of width by height pixels and returns the size
+	// cameras should apply their viewports to. At full fixed scale it draws straight to the window.
+	glm::vec2 begin(int width, int height);
+	// Upscales the scene into the window framebuffer and leaves it bound at native resolution
+	void end(int width, int height);
+	// Smoothed GPU time of the scene pass, zero until the first result arrives
+	double gpuMilliseconds() const { return smoothedMilliseconds; }
+};
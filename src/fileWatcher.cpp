@@ -0,0 +1,124 @@
+#include "fileWatcher.h"
+#include <chrono>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(std::filesystem::path _root, std::function<void(const std::filesystem::path&)> _onChange) :
+	root(_root.lexically_normal()), onChange(_onChange) {
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd < 0) {
+		std::cout << "Failed to start inotify, hot reload disabled" << std::endl;
+		return;
+	}
+	addWatch(root);
+	for (auto const& entry : std::filesystem::recursive_directory_iterator{ root }) {
+		if (entry.is_directory())
+			addWatch(entry.path());
+	}
+	thread = std::thread(&FileWatcher::watchInotify, this);
+#else
+	thread = std::thread(&FileWatcher::watchPolling, this);
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+	running = false;
+	if (thread.joinable())
+		thread.join();
+#ifdef __linux__
+	if (inotifyFd >= 0)
+		close(inotifyFd);
+#endif
+}
+
+void FileWatcher::post(std::function<void()> task) {
+	// Without a watcher thread there is nowhere else to run it
+	if (!thread.joinable()) {
+		task();
+		return;
+	}
+	std::lock_guard<std::mutex> lock(postedMutex);
+	posted.push_back(std::move(task));
+}
+
+void FileWatcher::runPosted() {
+	std::vector<std::function<void()>> tasks;
+	{
+		std::lock_guard<std::mutex> lock(postedMutex);
+		std::swap(tasks, posted);
+	}
+	for (auto& task : tasks) {
+		task();
+	}
+}
+
+#ifdef __linux__
+void FileWatcher::addWatch(const std::filesystem::path& directory) {
+	// Editors usually save through a temporary file and rename it over the original
+	int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (wd < 0) {
+		std::cout << "Could not watch " << directory << std::endl;
+		return;
+	}
+	watches[wd] = directory.lexically_normal();
+}
+
+void FileWatcher::watchInotify() {
+	alignas(inotify_event) char buffer[4096];
+	pollfd descriptor{ inotifyFd, POLLIN, 0 };
+	while (running) {
+		runPosted();
+		// Wake up periodically so the destructor and posted tasks never wait long
+		if (poll(&descriptor, 1, 200) <= 0)
+			continue;
+		ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+		for (char* cursor = buffer; length > 0 && cursor < buffer + length;) {
+			auto event = reinterpret_cast<inotify_event*>(cursor);
+			cursor += sizeof(inotify_event) + event->len;
+			auto directory = watches.find(event->wd);
+			if (directory == watches.end() || event->len == 0)
+				continue;
+			auto changed = (directory->second / event->name).lexically_normal();
+			if (event->mask & IN_ISDIR) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					addWatch(changed);
+				continue;
+			}
+			// A created file is reported again once it is closed after writing
+			if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				onChange(changed);
+		}
+	}
+}
+#else
+void FileWatcher::watchPolling() {
+	std::unordered_map<std::string, std::filesystem::file_time_type> modified;
+	bool first = true;
+	while (running) {
+		runPosted();
+		std::error_code error;
+		for (auto const& entry : std::filesystem::recursive_directory_iterator{ root, error }) {
+			if (!entry.is_regular_file())
+				continue;
+			auto time = entry.last_write_time(error);
+			auto path = entry.path().lexically_normal();
+			auto [it, inserted] = modified.try_emplace(path.string(), time);
+			if (!inserted && it->second != time) {
+				it->second = time;
+				onChange(path);
+			}
+			else if (inserted && !first) {
+				onChange(path);
+			}
+		}
+		first = false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	}
+}
+#endif
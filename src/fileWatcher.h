@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Watches a directory tree on a background thread and reports files that finished changing.
+// Uses inotify on Linux and falls back to polling modification times elsewhere.
+class FileWatcher {
+	std::filesystem::path root;
+	std::function<void(const std::filesystem::path&)> onChange;
+	std::atomic<bool> running = true;
+	std::thread thread;
+	std::mutex postedMutex;
+	std::vector<std::function<void()>> posted;
+	void runPosted();
+#ifdef __linux__
+	int inotifyFd = -1;
+	std::unordered_map<int, std::filesystem::path> watches;
+	void addWatch(const std::filesystem::path& directory);
+	void watchInotify();
+#else
+	void watchPolling();
+#endif
+public:
+	// onChange is called from the watcher thread with lexically normalized paths
+	FileWatcher(std::filesystem::path _root, std::function<void(const std::filesystem::path&)> _onChange);
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	~FileWatcher();
+
+	// Runs task on the watcher thread between change checks, so slow work started from elsewhere
+	// stays off the calling thread
+	void post(std::function<void()> task);
+};
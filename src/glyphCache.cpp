@@ -0,0 +1,231 @@
+#include "glyphCache.h"
+#include <algorithm>
+#include <cmath>
+
+bool ShelfPacker::allocate(int w, int h, Region& out) {
+	Shelf* best = nullptr;
+	for (auto& shelf : shelves) {
+		// Empty shelves can be reused for anything that fits, partially used ones only for similar heights
+		bool suitable = shelf.height >= h && (shelf.cursor == 0 || shelf.height <= h + h / 3 + 2);
+		if (suitable && (best == nullptr || shelf.height < best->height)) {
+			bool hasSlot = shelf.cursor + w <= width;
+			for (auto& slot : shelf.freeSlots) {
+				hasSlot = hasSlot || slot.width >= w;
+			}
+			if (hasSlot)
+				best = &shelf;
+		}
+	}
+
+	if (best == nullptr) {
+		if (nextShelfY + h > height || w > width)
+			return false;
+		shelves.push_back({ nextShelfY, h, 0, {} });
+		nextShelfY += h;
+		best = &shelves.back();
+	}
+
+	out = { 0, best->y, w, h, (int)(best - shelves.data()) };
+	for (auto it = best->freeSlots.begin(); it != best->freeSlots.end(); ++it) {
+		if (it->width >= w) {
+			out.x = it->x;
+			it->x += w;
+			it->width -= w;
+			if (it->width == 0)
+				best->freeSlots.erase(it);
+			return true;
+		}
+	}
+	out.x = best->cursor;
+	best->cursor += w;
+	return true;
+}
+
+void ShelfPacker::release(const Region& region) {
+	auto& shelf = shelves[region.shelf];
+	auto& slots = shelf.freeSlots;
+	auto it = std::lower_bound(slots.begin(), slots.end(), region.x, [](const Slot& slot, int x) {
+		return slot.x < x;
+	});
+	it = slots.insert(it, { region.x, region.width });
+
+	// Coalesce with the neighbouring free slots
+	if (auto next = it + 1; next != slots.end() && it->x + it->width == next->x) {
+		it->width += next->width;
+		slots.erase(next);
+	}
+	if (it != slots.begin()) {
+		auto prev = it - 1;
+		if (prev->x + prev->width == it->x) {
+			prev->width += it->width;
+			it = slots.erase(it) - 1;
+		}
+	}
+
+	// A free slot touching the end of the shelf just moves the cursor back
+	if (it->x + it->width == shelf.cursor) {
+		shelf.cursor = it->x;
+		slots.erase(it);
+	}
+}
+
+GlyphCache::GlyphCache(Font* _font, int _size, int atlasWidth, int atlasHeight, bool sdf) :
+	GlyphAtlas(_font, _size), packer(atlasWidth, atlasHeight) {
+	distanceField = sdf;
+	// Distances spread proportionally to the bake size so every size looks the same
+	spread = std::max(2, size / 8);
+	scale = stbtt_ScaleForPixelHeight(&font->info, size);
+	texture = std::make_shared<Texture>();
+	texture->width = atlasWidth;
+	texture->height = atlasHeight;
+	texture->pixelFormat = PixelFormat::negotiate(1);
+	// Mips would go stale on every sub image upload
+	texture->generateMipmaps = false;
+	std::vector<unsigned char> blank(atlasWidth * atlasHeight);
+	texture->Init(blank.data());
+}
+
+bool GlyphCache::evictOne() {
+	if (lru.empty() || lru.back().lastUsedFrame == frame)
+		return false;
+	auto& victim = lru.back();
+	if (victim.region.shelf >= 0)
+		packer.release(victim.region);
+	glyphs.erase(victim.codepoint);
+	lru.pop_back();
+	generation++;
+	return true;
+}
+
+bool GlyphCache::place(Glyph& glyph, int width, int height) {
+	int paddedWidth = width + padding * 2;
+	int paddedHeight = height + padding * 2;
+	while (!packer.allocate(paddedWidth, paddedHeight, glyph.region)) {
+		if (!evictOne()) {
+			dropped++;
+			if (dropped == 1)
+				std::cout << "Glyph cache full, dropping codepoint " << glyph.codepoint << " and any others that don't fit" << std::endl;
+			return false;
+		}
+	}
+	// Upload the padding too so reused slots don't bleed the previous glyph
+	scratch.assign(paddedWidth * paddedHeight, 0);
+	return true;
+}
+
+GlyphCache::Glyph* GlyphCache::rasterize(uint32_t codepoint) {
+	Glyph glyph;
+	glyph.codepoint = codepoint;
+	glyph.lastUsedFrame = frame;
+	glyph.region = { 0, 0, 0, 0, -1 };
+
+	int advance, leftBearing;
+	stbtt_GetCodepointHMetrics(&font->info, codepoint, &advance, &leftBearing);
+	glyph.advance = advance * scale;
+
+	int width = 0, height = 0;
+	if (distanceField) {
+		int xoff = 0, yoff = 0;
+		unsigned char* sdf = stbtt_GetCodepointSDF(
+			&font->info,
+			scale,
+			codepoint,
+			spread,
+			SDF_ON_EDGE_VALUE,
+			(float)SDF_ON_EDGE_VALUE / spread,
+			&width,
+			&height,
+			&xoff,
+			&yoff
+		);
+		glyph.xoff = xoff;
+		glyph.yoff = yoff;
+		glyph.xoff2 = xoff + width;
+		glyph.yoff2 = yoff + height;
+		if (sdf != nullptr) {
+			bool placed = place(glyph, width, height);
+			if (placed) {
+				int stride = width + padding * 2;
+				for (int row = 0; row < height; row++) {
+					std::copy(sdf + row * width, sdf + (row + 1) * width, scratch.data() + (row + padding) * stride + padding);
+				}
+			}
+			stbtt_FreeSDF(sdf, nullptr);
+			if (!placed)
+				return nullptr;
+		}
+	}
+	else {
+		int x0, y0, x1, y1;
+		stbtt_GetCodepointBitmapBox(&font->info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+		glyph.xoff = x0;
+		glyph.yoff = y0;
+		glyph.xoff2 = x1;
+		glyph.yoff2 = y1;
+		width = x1 - x0;
+		height = y1 - y0;
+		if (width > 0 && height > 0) {
+			if (!place(glyph, width, height))
+				return nullptr;
+			int stride = width + padding * 2;
+			stbtt_MakeCodepointBitmap(
+				&font->info,
+				scratch.data() + padding * stride + padding,
+				width,
+				height,
+				stride,
+				scale,
+				scale,
+				codepoint
+			);
+		}
+	}
+
+	auto& region = glyph.region;
+	if (region.shelf >= 0)
+		texture->update(region.x, region.y, region.width, region.height, scratch.data());
+
+	lru.push_front(glyph);
+	glyphs[codepoint] = lru.begin();
+	return &lru.front();
+}
+
+void GlyphCache::touch(uint64_t c) {
+	if (auto it = glyphs.find((uint32_t)c); it != glyphs.end()) {
+		lru.splice(lru.begin(), lru, it->second);
+		lru.front().lastUsedFrame = frame;
+	}
+}
+
+stbtt_aligned_quad GlyphCache::renderChar(uint64_t c, float* x, float* y) {
+	stbtt_aligned_quad quad = {};
+	uint32_t codepoint = (uint32_t)c;
+	Glyph* glyph = nullptr;
+	if (auto it = glyphs.find(codepoint); it != glyphs.end()) {
+		touch(codepoint);
+		glyph = &lru.front();
+	}
+	else {
+		glyph = rasterize(codepoint);
+	}
+	if (glyph == nullptr)
+		return quad;
+
+	float invWidth = 1.0f / texture->width;
+	float invHeight = 1.0f / texture->height;
+	float x0 = std::floor(*x + glyph->xoff + 0.5f);
+	float y0 = std::floor(*y + glyph->yoff + 0.5f);
+	quad.x0 = x0;
+	quad.y0 = y0;
+	quad.x1 = x0 + glyph->xoff2 - glyph->xoff;
+	quad.y1 = y0 + glyph->yoff2 - glyph->yoff;
+	*x += glyph->advance;
+	auto& region = glyph->region;
+	if (region.shelf < 0)
+		return quad;
+	quad.s0 = (region.x + padding) * invWidth;
+	quad.t0 = (region.y + padding) * invHeight;
+	quad.s1 = (region.x + region.width - padding) * invWidth;
+	quad.t1 = (region.y + region.height - padding) * invHeight;
+	return quad;
+}
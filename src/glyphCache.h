@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "text.h"
+#include "texture.h"
+
+// Shelf packer that hands out rectangles from a fixed size atlas and takes them back on eviction
+class ShelfPacker {
+	struct Slot {
+		int x, width;
+	};
+	struct Shelf {
+		int y, height, cursor;
+		std::vector<Slot> freeSlots;
+	};
+	int width, height;
+	int nextShelfY = 0;
+	std::vector<Shelf> shelves;
+public:
+	struct Region {
+		int x, y, width, height;
+		int shelf;
+	};
+	ShelfPacker(int _width, int _height) : width(_width), height(_height) {}
+
+	bool allocate(int w, int h, Region& out);
+	void release(const Region& region);
+};
+
+// Glyph atlas which rasterizes codepoints on first use and evicts the least recently used ones when full.
+// In distance field mode glyphs are stored as signed distances so a single small bake scales to any size.
+class GlyphCache : public GlyphAtlas {
+	static const unsigned char SDF_ON_EDGE_VALUE = 128;
+	struct Glyph {
+		uint32_t codepoint;
+		ShelfPacker::Region region;
+		float xoff, yoff, xoff2, yoff2;
+		float advance;
+		uint64_t lastUsedFrame;
+	};
+	float scale;
+	int padding = 1;
+	// Distance in pixels covered by the field outside of the glyph outline
+	int spread;
+	uint64_t frame = 0;
+	ShelfPacker packer;
+	// Front is most recently used
+	std::list<Glyph> lru;
+	std::unordered_map<uint32_t, std::list<Glyph>::iterator> glyphs;
+	std::vector<unsigned char> scratch;
+	// Glyphs that found no room. Only the first is logged, text laid out every frame would repeat it
+	std::size_t dropped = 0;
+
+	bool place(Glyph& glyph, int width, int height);
+	Glyph* rasterize(uint32_t codepoint);
+	bool evictOne();
+public:
+	std::shared_ptr<Texture> texture;
+
+	GlyphCache(Font* _font, int _size, int atlasWidth = 1024, int atlasHeight = 1024, bool sdf = false);
+
+	stbtt_aligned_quad renderChar(uint64_t c, float* x, float* y) override;
+
+	Texture* getTexture() override { return texture.get(); }
+
+	// Glyphs touched during the current frame are never evicted
+	void nextFrame() override { frame++; }
+
+	void touch(uint64_t c) override;
+
+	std::size_t glyphCount() const { return glyphs.size(); }
+	std::size_t droppedCount() const { return dropped; }
+};
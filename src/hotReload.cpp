@@ -0,0 +1,92 @@
+#include "hotReload.h"
+#include <vector>
+
+namespace {
+	bool isShader(const std::filesystem::path& p) {
+		auto extension = p.extension();
+		return extension == ".vert" || extension == ".frag" || extension == ".glsl";
+	}
+
+	bool isImage(const std::filesystem::path& p) {
+		auto extension = p.extension();
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp" || extension == ".tga";
+	}
+}
+
+HotReloader::HotReloader(std::filesystem::path _root, std::filesystem::path _loadedRoot, ShaderLoader& shaderLoader, TextureLoader& textureLoader) :
+	shaders(shaderLoader), textures(textureLoader), root(_root.lexically_normal()), loadedRoot(_loadedRoot.lexically_normal()),
+	watcher(_root, [this](const std::filesystem::path& p) { onChange(p); }) {}
+
+std::filesystem::path HotReloader::toLoaded(const std::filesystem::path& p) const {
+	return (loadedRoot / p.lexically_relative(root)).lexically_normal();
+}
+
+void HotReloader::onChange(const std::filesystem::path& p) {
+	if (!isShader(p) && !isImage(p))
+		return;
+	auto loaded = toLoaded(p);
+	// Keep the copy the loaders read in step, shaders re-read their other stage and evicted
+	// textures restore from it
+	std::error_code error;
+	if (!std::filesystem::equivalent(p, loaded, error)) {
+		std::filesystem::create_directories(loaded.parent_path(), error);
+		std::filesystem::copy_file(p, loaded, std::filesystem::copy_options::overwrite_existing, error);
+		if (error)
+			std::cout << "Could not copy " << p << " to " << loaded << ": " << error.message() << std::endl;
+	}
+	if (isShader(p)) {
+		std::string source;
+		try {
+			source = FS::readFile(p);
+		}
+		catch (const std::runtime_error& e) {
+			std::cout << e.what() << std::endl;
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingShaders[loaded.string()] = std::move(source);
+	}
+	else {
+		auto image = ImageTexture::Decode(p);
+		if (!image.pixels)
+			return;
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingTextures[loaded.string()] = std::move(image);
+	}
+}
+
+void HotReloader::apply() {
+	std::unordered_map<std::string, std::string> readyShaders;
+	std::unordered_map<std::string, ImageData> readyTextures;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (pendingShaders.empty() && pendingTextures.empty())
+			return;
+		std::swap(readyShaders, pendingShaders);
+		std::swap(readyTextures, pendingTextures);
+	}
+	for (auto& [p, source] : readyShaders) {
+		if (shaders.uses(p))
+			shaders.reload(p, source);
+	}
+	for (auto& [p, image] : readyTextures) {
+		if (textures.uses(p))
+			textures.reload(p, image);
+	}
+}
+
+void HotReloader::reloadAll() {
+	// The loaders are only safe to ask from here, the reading and decoding is left to the watcher
+	std::vector<std::filesystem::path> assets;
+	for (auto const& entry : std::filesystem::recursive_directory_iterator{ root }) {
+		auto p = entry.path().lexically_normal();
+		auto loaded = toLoaded(p);
+		if (entry.is_regular_file() && (shaders.uses(loaded) || textures.uses(loaded)))
+			assets.push_back(p);
+	}
+	watcher.post([this, assets]() {
+		for (auto& p : assets) {
+			onChange(p);
+		}
+	});
+}
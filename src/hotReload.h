@@ -0,0 +1,40 @@
+#pragma once
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "fileWatcher.h"
+#include "resourceLoader.h"
+#include "texture.h"
+
+// The resources directory in the source tree, which the build copies next to the executable.
+// Artists edit this one, so it is what gets watched.
+#ifndef RESOURCE_SOURCE_DIR
+#define RESOURCE_SOURCE_DIR "resources"
+#endif
+
+// Reads and decodes changed assets on the watcher thread, then swaps them into the loaders
+// from the GL thread so existing shared_ptr handles pick up the new versions
+class HotReloader {
+	ShaderLoader& shaders;
+	TextureLoader& textures;
+	std::mutex mutex;
+	std::unordered_map<std::string, std::string> pendingShaders;
+	std::unordered_map<std::string, ImageData> pendingTextures;
+	// Where edits happen and where the loaders read from, the same directory when run from the source tree
+	std::filesystem::path root;
+	std::filesystem::path loadedRoot;
+	// Declared last so the watcher thread stops before the queues go away
+	FileWatcher watcher;
+
+	void onChange(const std::filesystem::path& p);
+	std::filesystem::path toLoaded(const std::filesystem::path& p) const;
+public:
+	HotReloader(std::filesystem::path root, std::filesystem::path loadedRoot, ShaderLoader& shaderLoader, TextureLoader& textureLoader);
+
+	// Applies everything that finished loading since the last call, call once per frame
+	void apply();
+	// Queues every asset in use for reloading on the watcher thread, whether or not it changed
+	void reloadAll();
+};
@@ -1,76 +1,73 @@
 #include "mesh.h"
 
-Mesh::Mesh(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int attrib_size = 3, int drawType = GL_STATIC_DRAW) : Positions(geometry), shader(s), ATTRIB_SIZE(attrib_size) {
-    std::cout << "Constructing mesh" << std::endl;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * Positions.size(), Positions.data(), drawType);
-    glVertexAttribPointer(0, ATTRIB_SIZE, GL_FLOAT, GL_FALSE, ATTRIB_SIZE * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+Mesh::Mesh(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int attrib_size = 3, int drawType = GL_STATIC_DRAW) :
+    Mesh(geometry, s, attrib_size, std::make_unique<VertexArray>(VertexLayout::floats(0, attrib_size), drawType)) {
+    vertices->setVertexData(Positions.data(), sizeof(float) * Positions.size(), Positions.size() / ATTRIB_SIZE);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+Mesh::Mesh(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int attrib_size, std::unique_ptr<VertexArray> v) :
+    Positions(geometry), ATTRIB_SIZE(attrib_size), shader(s), vertices(std::move(v)) {
+    std::cout << "Constructing mesh" << std::endl;
 }
 
 void Mesh::updatePositions() {
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * Positions.size(), Positions.data());
+    vertices->setVertexData(Positions.data(), sizeof(float) * Positions.size(), Positions.size() / ATTRIB_SIZE);
 }
 
 void Mesh::draw() {
     shader->use();
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, Positions.size() / ATTRIB_SIZE);
+    vertices->draw();
 }
 
-Mesh::~Mesh() {
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+Shape::Shape(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int drawType = GL_STATIC_DRAW, Primitive primitive) :
+    Mesh(geometry, s, 2, drawType) {
+    vertices->setQuadIndexing(primitive == Primitive::Quads);
 }
 
-Shape::Shape(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int drawType = GL_STATIC_DRAW) : Mesh(geometry, s, 2, drawType) {}
-
 
 TexturedMesh::TexturedMesh(
     std::vector<float> geometry,
     std::vector<float> uv,
     std::shared_ptr<ShaderProgram> s,
     std::shared_ptr<Texture> t,
-    int drawType = GL_STATIC_DRAW
-) : Shape(geometry, s, drawType), texture(t), UV(uv) {
-    glGenVertexArrays(1, &textureVAO);
-    glGenBuffers(1, &textureVBO);
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, textureVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * UV.size(), UV.data(), GL_STATIC_DRAW);
+    int drawType = GL_STATIC_DRAW,
+    Primitive primitive
+) : Mesh(geometry, s, 2, std::make_unique<VertexArray>(VertexLayout::of<TexturedVertex>(), drawType)), texture(t), UV(uv) {
+    vertices->setQuadIndexing(primitive == Primitive::Quads);
+    upload();
+}
 
-    glVertexAttribPointer(1, UV_SIZE, GL_FLOAT, GL_FALSE, sizeof(float) * UV_SIZE, (void*)0);
-    glEnableVertexAttribArray(1);
+void TexturedMesh::upload() {
+    std::size_t count = std::min(Positions.size() / ATTRIB_SIZE, UV.size() / UV_SIZE);
+    interleaved.resize(count);
+    for (std::size_t i = 0; i < count; i++) {
+        interleaved[i].position = glm::vec2(Positions[i * ATTRIB_SIZE], Positions[i * ATTRIB_SIZE + 1]);
+        interleaved[i].uv = glm::vec2(UV[i * UV_SIZE], UV[i * UV_SIZE + 1]);
+    }
+    vertices->setVertices(interleaved);
+    dirty = false;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, 1);
-    glBindVertexArray(1);
+// Positions and UVs usually change together, so both only mark the buffer and draw uploads once
+void TexturedMesh::updatePositions() {
+    dirty = true;
 }
 
 void TexturedMesh::updateUVs() {
-    glBindBuffer(GL_ARRAY_BUFFER, textureVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * UV.size(), UV.data());
+    dirty = true;
 }
 
 void TexturedMesh::draw() {
+    if (dirty)
+        upload();
     shader->use();
     texture->setActive();
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture->textureId);
-    glBindVertexArray(textureVAO);
-    Mesh::draw();
+    vertices->draw();
 }
 
 void TexturedMesh::setTexture(std::shared_ptr<Texture> t)
 {
     texture = t;
 }
-
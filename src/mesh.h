@@ -3,33 +3,61 @@
 #include <memory>
 #include <iostream>
 #include <glad/glad.h>
+#include <glm/vec2.hpp>
 #include "texture.h"
 #include "shader.h"
+#include "vertexLayout.h"
+
+struct TexturedVertex {
+    glm::vec2 position;
+    glm::vec2 uv;
+};
+
+template <>
+struct VertexDescription<TexturedVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        attribute<glm::vec2>(0, offsetof(TexturedVertex, position)),
+        attribute<glm::vec2>(1, offsetof(TexturedVertex, uv))
+    };
+};
+
+enum class Primitive {
+    Triangles,
+    // Four vertices per quad: top right, bottom right, top left, bottom left
+    Quads
+};
 
 struct Mesh {
     std::vector<float> Positions;
-    unsigned int VBO;
-    unsigned int VAO;
     int ATTRIB_SIZE;
     std::shared_ptr<ShaderProgram> shader;
+    std::unique_ptr<VertexArray> vertices;
     Mesh(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int attrib_size, int drawType);
-    void updatePositions();
+    virtual void updatePositions();
     virtual void draw();
-    ~Mesh();
+    virtual ~Mesh() = default;
+protected:
+    // For meshes that lay out their own vertex buffer
+    Mesh(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int attrib_size, std::unique_ptr<VertexArray> v);
 };
 
 struct Shape : public Mesh {
-    Shape(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int drawType);
+    Shape(std::vector<float> geometry, std::shared_ptr<ShaderProgram> s, int drawType, Primitive primitive = Primitive::Triangles);
 };
 
-struct TexturedMesh : public Shape {
+// Positions and UVs are kept apart for callers and interleaved into one buffer on upload
+struct TexturedMesh : public Mesh {
     std::shared_ptr<Texture> texture;
     std::vector<float> UV;
-    unsigned int textureVBO;
-    unsigned int textureVAO;
     static const int UV_SIZE = 2;
-    TexturedMesh(std::vector<float> geometry, std::vector<float> uv, std::shared_ptr<ShaderProgram> s, std::shared_ptr<Texture> t, int drawType);
+    TexturedMesh(std::vector<float> geometry, std::vector<float> uv, std::shared_ptr<ShaderProgram> s, std::shared_ptr<Texture> t, int drawType,
+        Primitive primitive = Primitive::Triangles);
+    void updatePositions() override;
     void updateUVs();
     void setTexture(std::shared_ptr<Texture> t);
     virtual void draw();
-};
\ No newline at end of file
+private:
+    bool dirty = true;
+    std::vector<TexturedVertex> interleaved;
+    void upload();
+};
@@ -0,0 +1,167 @@
+#include "particles.h"
+#include <algorithm>
+#include <cmath>
+#include "simd.h"
+#include "utils.h"
+
+namespace {
+	// Fields of the instance buffer, each a region of capacity entries
+	constexpr std::size_t fieldX = 0;
+	constexpr std::size_t fieldY = 1;
+	constexpr std::size_t fieldFade = 2;
+	constexpr std::size_t fieldColor = 3;
+	constexpr std::size_t fieldBytes = 4;
+	constexpr std::size_t fieldCount = 4;
+
+	// Below this each thread would have too little to do to pay for starting it
+	constexpr std::size_t particlesPerWorker = 16384;
+
+	VertexLayout instanceField(GLuint location) {
+		auto layout = VertexLayout::floats(location, 1);
+		layout.divisor = 1;
+		return layout;
+	}
+
+	std::uint8_t toByte(float value) {
+		return std::uint8_t(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+	}
+}
+
+ParticleSystem::ParticleSystem(std::shared_ptr<ShaderProgram> s, std::size_t _capacity) :
+	capacity(_capacity), shader(s), random(std::random_device{}()) {
+	for (auto field : { &x, &y, &velocityX, &velocityY, &life, &inverseLifetime, &fade }) {
+		field->resize(capacity);
+	}
+	color.resize(capacity);
+
+	glGenBuffers(1, &instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, capacity * fieldBytes * fieldCount, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Drawn as a strip in the same corner order as sprite quads so it faces the same way
+	quad = std::make_unique<VertexArray>(VertexLayout::floats(0, 2));
+	quad->setVertices(std::vector<glm::vec2> { { 0.5f, 0.5f }, { 0.5f, -0.5f }, { -0.5f, 0.5f }, { -0.5f, -0.5f } });
+	quad->addBuffer(instanceBuffer, instanceField(1), capacity * fieldBytes * fieldX);
+	quad->addBuffer(instanceBuffer, instanceField(2), capacity * fieldBytes * fieldY);
+	quad->addBuffer(instanceBuffer, instanceField(3), capacity * fieldBytes * fieldFade);
+	VertexLayout colorLayout{ { attribute<Rgba8>(4, 0, true) }, GLsizei(sizeof(Rgba8)), 1 };
+	quad->addBuffer(instanceBuffer, colorLayout, capacity * fieldBytes * fieldColor);
+}
+
+ParticleSystem::~ParticleSystem() {
+	glDeleteBuffers(1, &instanceBuffer);
+}
+
+void ParticleSystem::emit(std::size_t spawn, glm::vec2 origin, float speed, glm::vec4 tint, float lifetime) {
+	spawn = std::min(spawn, capacity - count);
+	std::uniform_real_distribution<float> angle{ 0.0f, 6.2831853f };
+	std::uniform_real_distribution<float> jitter{ 0.25f, 1.0f };
+	Rgba8 packed{ toByte(tint.x), toByte(tint.y), toByte(tint.z), toByte(tint.w) };
+	for (std::size_t i = count; i < count + spawn; i++) {
+		float direction = angle(random);
+		float velocity = speed * jitter(random);
+		float lasts = lifetime * (0.5f + 0.5f * jitter(random));
+		x[i] = origin.x;
+		y[i] = origin.y;
+		velocityX[i] = std::cos(direction) * velocity;
+		velocityY[i] = std::sin(direction) * velocity;
+		life[i] = lasts;
+		inverseLifetime[i] = 1.0f / lasts;
+		fade[i] = 1.0f;
+		color[i] = packed;
+	}
+	count += spawn;
+}
+
+void ParticleSystem::simulate(std::size_t begin, std::size_t end, float dt) {
+	float damping = std::max(0.0f, 1.0f - drag * dt);
+	float pullX = gravity.x * dt;
+	float pullY = gravity.y * dt;
+
+	std::size_t i = begin;
+	Simd::Float step = Simd::splat(dt);
+	Simd::Float damp = Simd::splat(damping);
+	Simd::Float gravityX = Simd::splat(pullX);
+	Simd::Float gravityY = Simd::splat(pullY);
+	Simd::Float zero = Simd::splat(0.0f);
+	for (; i + Simd::width <= end; i += Simd::width) {
+		Simd::Float vx = Simd::mul(Simd::add(Simd::load(&velocityX[i]), gravityX), damp);
+		Simd::Float vy = Simd::mul(Simd::add(Simd::load(&velocityY[i]), gravityY), damp);
+		Simd::store(&velocityX[i], vx);
+		Simd::store(&velocityY[i], vy);
+		Simd::store(&x[i], Simd::add(Simd::load(&x[i]), Simd::mul(vx, step)));
+		Simd::store(&y[i], Simd::add(Simd::load(&y[i]), Simd::mul(vy, step)));
+		Simd::Float left = Simd::sub(Simd::load(&life[i]), step);
+		Simd::store(&life[i], left);
+		Simd::store(&fade[i], Simd::max(zero, Simd::mul(left, Simd::load(&inverseLifetime[i]))));
+	}
+	for (; i < end; i++) {
+		velocityX[i] = (velocityX[i] + pullX) * damping;
+		velocityY[i] = (velocityY[i] + pullY) * damping;
+		x[i] += velocityX[i] * dt;
+		y[i] += velocityY[i] * dt;
+		life[i] -= dt;
+		fade[i] = std::max(0.0f, life[i] * inverseLifetime[i]);
+	}
+}
+
+void ParticleSystem::compact() {
+	std::size_t i = 0;
+	while (i < count) {
+		if (life[i] > 0.0f) {
+			i++;
+			continue;
+		}
+		count--;
+		x[i] = x[count];
+		y[i] = y[count];
+		velocityX[i] = velocityX[count];
+		velocityY[i] = velocityY[count];
+		life[i] = life[count];
+		inverseLifetime[i] = inverseLifetime[count];
+		fade[i] = fade[count];
+		color[i] = color[count];
+	}
+}
+
+void ParticleSystem::update(float dt) {
+	if (count == 0)
+		return;
+	unsigned int threads = std::max<std::size_t>(1, std::min<std::size_t>(workerCount, count / particlesPerWorker));
+	Parallel::forRange(count, threads, [&](std::size_t begin, std::size_t end) {
+		simulate(begin, end, dt);
+	});
+	compact();
+}
+
+void ParticleSystem::draw(Camera& view) {
+	if (count == 0)
+		return;
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	// Orphaned so the driver never waits on last frame's draw before taking the new data
+	glBufferData(GL_ARRAY_BUFFER, capacity * fieldBytes * fieldCount, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, capacity * fieldBytes * fieldX, count * fieldBytes, x.data());
+	glBufferSubData(GL_ARRAY_BUFFER, capacity * fieldBytes * fieldY, count * fieldBytes, y.data());
+	glBufferSubData(GL_ARRAY_BUFFER, capacity * fieldBytes * fieldFade, count * fieldBytes, fade.data());
+	glBufferSubData(GL_ARRAY_BUFFER, capacity * fieldBytes * fieldColor, count * sizeof(Rgba8), color.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	shader->use()
+		->setUniform1f("size", particleSize)
+		->setUniform1f("depth", depth);
+	view.use();
+
+	GLboolean blending = glIsEnabled(GL_BLEND);
+	GLint blendSource, blendDestination;
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blendDestination);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDepthMask(GL_FALSE);
+	quad->drawInstanced(count, GL_TRIANGLE_STRIP);
+	glDepthMask(GL_TRUE);
+	if (!blending)
+		glDisable(GL_BLEND);
+	glBlendFunc(blendSource, blendDestination);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include "camera.h"
+#include "shader.h"
+#include "vertexLayout.h"
+
+// Particles stored as a structure of arrays, one array per field. The update streams through the
+// fields with SIMD on worker threads and the drawn fields are copied as they are into their own
+// region of the instance buffer. Every live particle goes out in one instanced draw with additive
+// blending, which looks the same in any order so nothing needs sorting.
+class ParticleSystem {
+	std::size_t capacity;
+	std::size_t count = 0;
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> velocityX;
+	std::vector<float> velocityY;
+	// Seconds left to live
+	std::vector<float> life;
+	std::vector<float> inverseLifetime;
+	// Life left as a fraction, fades the colour out
+	std::vector<float> fade;
+	std::vector<Rgba8> color;
+	std::shared_ptr<ShaderProgram> shader;
+	std::unique_ptr<VertexArray> quad;
+	GLuint instanceBuffer = 0;
+	std::mt19937 random;
+
+	void simulate(std::size_t begin, std::size_t end, float dt);
+	// Moves the last live particles into the slots of dead ones
+	void compact();
+public:
+	// World units per second squared, y grows downwards like the 2D cameras
+	glm::vec2 gravity = { 0.0f, 1.5f };
+	// Fraction of velocity lost per second
+	float drag = 0.5f;
+	// World size of a particle's quad
+	float particleSize = 0.02f;
+	// Plane particles are drawn on
+	float depth = 2.0f;
+	unsigned int workerCount = std::thread::hardware_concurrency();
+
+	ParticleSystem(std::shared_ptr<ShaderProgram> shader, std::size_t capacity = std::size_t(1) << 20);
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+	~ParticleSystem();
+
+	// Spawns count particles at origin flying off in random directions, fewer once full
+	void emit(std::size_t count, glm::vec2 origin, float speed, glm::vec4 color, float lifetime);
+	void update(float dt);
+	void draw(Camera& view);
+	std::size_t liveCount() const { return count; }
+};
@@ -0,0 +1,156 @@
+#include "renderTarget.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+RenderTarget::RenderTarget(int w, int h, PixelFormat format, bool _depth) :
+	width(std::max(1, w)), height(std::max(1, h)), colorFormat(format), depth(_depth) {
+	color = std::make_shared<Texture>();
+	color->generateMipmaps = false;
+	allocate();
+}
+
+RenderTarget::~RenderTarget() {
+	if (depthBuffer != 0)
+		glDeleteRenderbuffers(1, &depthBuffer);
+	glDeleteFramebuffers(1, &framebuffer);
+}
+
+void RenderTarget::resize(int w, int h) {
+	// Minimised windows report a zero sized framebuffer
+	w = std::max(1, w);
+	h = std::max(1, h);
+	if (w == width && h == height)
+		return;
+	width = w;
+	height = h;
+	allocate();
+}
+
+void RenderTarget::allocate() {
+	GLint previous;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	if (framebuffer == 0)
+		glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	// Immutable storage can't change size so the texture is recreated under the same handle
+	if (color->textureId != 0)
+		color->unload();
+	color->width = width;
+	color->height = height;
+	color->pixelFormat = colorFormat;
+	color->Init(nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color->textureId, 0);
+
+	if (depth) {
+		if (depthBuffer == 0)
+			glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Render target " << width << " x " << height << " is incomplete" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+}
+
+void RenderTarget::bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+void RenderTarget::bindDefault(int width, int height) {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+}
+
+glm::vec2 RenderTarget::size() const {
+	return glm::vec2(width, height);
+}
+
+void RenderTarget::blit(RenderTarget* destination, int destinationWidth, int destinationHeight, GLenum filter) {
+	blitRegion(width, height, destination, destinationWidth, destinationHeight, filter);
+}
+
+void RenderTarget::blitRegion(int sourceWidth, int sourceHeight, RenderTarget* destination, int destinationWidth, int destinationHeight, GLenum filter) {
+	GLint previousRead, previousDraw;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDraw);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination ? destination->framebuffer : 0);
+	glBlitFramebuffer(0, 0, sourceWidth, sourceHeight, 0, 0, destinationWidth, destinationHeight, GL_COLOR_BUFFER_BIT, filter);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousRead);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDraw);
+}
+
+bool RenderTarget::matches(int w, int h, const PixelFormat& format, bool _depth) const {
+	return width == w && height == h && colorFormat.internalFormat == format.internalFormat && depth == _depth;
+}
+
+std::size_t RenderTarget::gpuBytes() const {
+	std::size_t bytes = color->gpuBytes();
+	if (depth)
+		bytes += std::size_t(width) * height * 4;
+	return bytes;
+}
+
+RenderTargetPool::RenderTargetPool(int w, int h) : screenWidth(w), screenHeight(h) {}
+
+std::shared_ptr<RenderTarget> RenderTargetPool::reuse(int width, int height, const PixelFormat& format, bool depth, float screenScale) {
+	// Only the pool holding a target means whoever acquired it is done with it
+	for (auto& entry : entries) {
+		auto& target = entry.target;
+		if (target.use_count() == 1 && target->screenScale == screenScale && target->matches(width, height, format, depth)) {
+			entry.lastUsed = frame;
+			return target;
+		}
+	}
+	auto target = std::make_shared<RenderTarget>(width, height, format, depth);
+	target->screenScale = screenScale;
+	entries.push_back({ target, frame });
+	return target;
+}
+
+std::shared_ptr<RenderTarget> RenderTargetPool::acquire(int width, int height, PixelFormat format, bool depth) {
+	return reuse(std::max(1, width), std::max(1, height), format, depth, 0.0f);
+}
+
+std::shared_ptr<RenderTarget> RenderTargetPool::acquireScreen(float scale, PixelFormat format, bool depth) {
+	int width = std::max(1, int(std::lround(screenWidth * scale)));
+	int height = std::max(1, int(std::lround(screenHeight * scale)));
+	return reuse(width, height, format, depth, scale);
+}
+
+void RenderTargetPool::resize(int w, int h) {
+	screenWidth = w;
+	screenHeight = h;
+	for (auto& entry : entries) {
+		auto& target = *entry.target;
+		if (target.screenScale > 0.0f)
+			target.resize(int(std::lround(w * target.screenScale)), int(std::lround(h * target.screenScale)));
+	}
+}
+
+void RenderTargetPool::nextFrame() {
+	frame++;
+	for (auto& entry : entries) {
+		if (entry.target.use_count() > 1)
+			entry.lastUsed = frame;
+	}
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const Entry& entry) {
+		return frame - entry.lastUsed > std::uint64_t(idleFrames);
+	}), entries.end());
+}
+
+std::size_t RenderTargetPool::gpuBytes() const {
+	std::size_t bytes = 0;
+	for (auto& entry : entries) {
+		bytes += entry.target->gpuBytes();
+	}
+	return bytes;
+}
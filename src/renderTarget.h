@@ -0,0 +1,77 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/vec2.hpp>
+
+#include "texture.h"
+
+// Framebuffer drawn into instead of the window, with a colour texture that can be sampled afterwards
+// and an optional depth and stencil renderbuffer.
+struct RenderTarget {
+	int width;
+	int height;
+	PixelFormat colorFormat;
+	bool depth;
+	// Above zero the size follows the window framebuffer times this, see RenderTargetPool::resize
+	float screenScale = 0.0f;
+	unsigned int framebuffer = 0;
+	unsigned int depthBuffer = 0;
+	// Keeps its handle across resizes, its version changes instead
+	std::shared_ptr<Texture> color;
+
+	RenderTarget(int width, int height, PixelFormat colorFormat = PixelFormat::negotiate(4), bool depth = true);
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+	~RenderTarget();
+
+	// Reallocates the attachments at the new size, the old contents are lost
+	void resize(int width, int height);
+	// Binds for drawing with the viewport covering the whole target
+	void bind();
+	// Back to the window's framebuffer with a viewport of width by height pixels
+	static void bindDefault(int width, int height);
+	glm::vec2 size() const;
+	// Scales the colour into destination, null is the window's framebuffer
+	void blit(RenderTarget* destination, int destinationWidth, int destinationHeight, GLenum filter = GL_LINEAR);
+	// Same for only the sourceWidth by sourceHeight pixels in the bottom left corner
+	void blitRegion(int sourceWidth, int sourceHeight, RenderTarget* destination, int destinationWidth, int destinationHeight, GLenum filter = GL_LINEAR);
+	bool matches(int width, int height, const PixelFormat& colorFormat, bool depth) const;
+	std::size_t gpuBytes() const;
+private:
+	void allocate();
+};
+
+// Hands out render targets for passes and takes them back once nobody holds them anymore.
+// A released target is given to the next acquire asking for the same size and format, targets left
+// unused for idleFrames are freed. Screen sized targets are resized along with the window.
+class RenderTargetPool {
+	struct Entry {
+		std::shared_ptr<RenderTarget> target;
+		std::uint64_t lastUsed;
+	};
+	std::vector<Entry> entries;
+	int screenWidth;
+	int screenHeight;
+	std::uint64_t frame = 0;
+
+	std::shared_ptr<RenderTarget> reuse(int width, int height, const PixelFormat& format, bool depth, float screenScale);
+public:
+	int idleFrames = 120;
+
+	RenderTargetPool(int screenWidth, int screenHeight);
+	RenderTargetPool(const RenderTargetPool&) = delete;
+	RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+	std::shared_ptr<RenderTarget> acquire(int width, int height, PixelFormat format = PixelFormat::negotiate(4), bool depth = true);
+	// Sized to the window framebuffer times scale and kept that way by resize
+	std::shared_ptr<RenderTarget> acquireScreen(float scale = 1.0f, PixelFormat format = PixelFormat::negotiate(4), bool depth = true);
+	// Call with the new framebuffer size whenever the window's changes
+	void resize(int screenWidth, int screenHeight);
+	// Call once per frame, frees the targets idle for longer than idleFrames
+	void nextFrame();
+	std::size_t size() const { return entries.size(); }
+	std::size_t gpuBytes() const;
+};
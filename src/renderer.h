@@ -1,16 +1,22 @@
 #pragma once
+#include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <exception>
 #include <vector>
 #include <iostream>
 #include <memory>
+#include <unordered_map>
 
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 
 #include "texture.h"
 #include "mesh.h"
 #include "camera.h"
 #include "text.h"
+#include "textLayout.h"
 
 using RenderableId = std::uint64_t;
 
@@ -34,21 +40,461 @@ struct Sprite {
     RenderableId id;
     std::shared_ptr<Texture> texture;
     glm::mat4 transform;
+    // Never moves, renderers that support it bake these once instead of drawing them every frame
+    bool isStatic;
 
-    Sprite(RenderableId _id, std::shared_ptr<Texture> _texture, glm::mat4 _transform):
-        id(_id), texture(_texture), transform(_transform) {}
+    Sprite(RenderableId _id, std::shared_ptr<Texture> _texture, glm::mat4 _transform, bool _isStatic = false):
+        id(_id), texture(_texture), transform(_transform), isStatic(_isStatic) {}
 };
 
-struct SpriteRenderer : public Renderer<Sprite> {
-    std::unique_ptr<TexturedMesh> mesh;
-    std::shared_ptr<PerspectiveCamera> camera;
-    SpriteRenderer(std::unique_ptr<TexturedMesh> m, std::shared_ptr<PerspectiveCamera> c): mesh(std::move(m)), camera(c) {}
+// Triangle fan over a texture's hull corners, as indices for spriteCount sprites of
+// Texture::hullVertexCount vertices each
+inline std::vector<std::uint32_t> hullFanIndices(std::size_t spriteCount) {
+    std::vector<std::uint32_t> indices;
+    indices.reserve(spriteCount * (Texture::hullVertexCount - 2) * 3);
+    for (std::size_t sprite = 0; sprite < spriteCount; sprite++) {
+        std::uint32_t first = std::uint32_t(sprite * Texture::hullVertexCount);
+        for (std::uint32_t corner = 1; corner + 1 < Texture::hullVertexCount; corner++) {
+            indices.insert(indices.end(), { first, first + corner, first + corner + 1 });
+        }
+    }
+    return indices;
+}
+
+// Per sprite data as the vertex shader fetches it from the transform buffer, five RGBA32F texels
+struct SpriteInstance {
+    glm::mat4 model;
+    // Only x is used, the rest pads to a whole texel
+    glm::vec4 layer;
+};
+
+// Per instance index into the transform buffer, lets a camera draw only the sprites it can see
+struct SpriteIndex {
+    std::uint32_t sprite;
+};
+
+template <>
+struct VertexDescription<SpriteIndex> {
+    static constexpr VertexAttribute attributes[] = {
+        attribute<std::uint32_t>(2, offsetof(SpriteIndex, sprite))
+    };
+};
+
+// Corner of a baked static sprite, already in world space. The uv's z is the texture array layer.
+struct StaticSpriteVertex {
+    glm::vec3 position;
+    glm::vec3 uv;
+};
+
+template <>
+struct VertexDescription<StaticSpriteVertex> {
+    static constexpr VertexAttribute attributes[] = {
+        attribute<glm::vec3>(0, offsetof(StaticSpriteVertex, position)),
+        attribute<glm::vec3>(1, offsetof(StaticSpriteVertex, uv))
+    };
+};
+
+// Draws all sprites in one instanced call by sampling their images from a texture array.
+// Transforms live in a texture buffer the vertex shader indexes through a per instance sprite index;
+// each frame only the ranges of sprites that changed are uploaded. The buffer is shared by every camera
+// drawing the batch, each one only submits the sprites inside its frustum.
+// Rather than a quad each sprite covers its texture's hull, so transparent borders cost no fragments.
+// Textures get a layer the first time a sprite uses them.
+// Static sprites are kept out of entities and baked into one world space vertex buffer. Opaque ones are
+// sorted into grid cells so cameras cull them a cell at a time, translucent ones are culled one by one.
+// Frames where none of them change cost no uploads for them.
+// Sprites with opaque textures are drawn first, nearest first without blending so hidden fragments fail
+// the depth test early, then every translucent sprite, baked or not, furthest first with blending and
+// no depth writes.
+struct SpriteBatchRenderer : public Renderer<Sprite> {
+    struct StaticCell {
+        glm::vec3 min;
+        glm::vec3 max;
+        std::size_t firstSprite;
+        std::size_t spriteCount;
+    };
+    struct StaticSprite {
+        glm::vec3 min;
+        glm::vec3 max;
+        // Position in the baked vertex buffer
+        std::size_t index;
+    };
+    struct SortedSprite {
+        float depth;
+        SpriteIndex index;
+    };
+
+    std::shared_ptr<ShaderProgram> shader;
+    std::shared_ptr<TextureArray> textures;
+    std::shared_ptr<Camera> camera;
+    // No vertex data, the shader fetches each sprite's hull corners by gl_VertexID
+    std::unique_ptr<VertexArray> hullFan;
+    // Draws the baked static sprites, without it every sprite is treated as dynamic
+    std::shared_ptr<ShaderProgram> staticShader;
+    // Call invalidateStatic after changing these
+    std::vector<Sprite> staticSprites;
+    // World units per side of the cells static sprites are culled by
+    float cellSize = 16.0f;
+    std::unique_ptr<VertexArray> staticVertices;
+    // Opaque static sprites by cell
+    std::vector<StaticCell> staticCells;
+    // Translucent static sprites, baked after the opaque ones
+    std::vector<StaticSprite> staticTranslucent;
+    // Alpha and outline of the textures the static set was baked with, a reload can change either
+    std::unordered_map<const Texture*, std::pair<AlphaMode, std::vector<glm::vec2>>> bakedTextures;
+    bool staticDirty = false;
+    // Draws every fragment as a fixed additive colour, brighter where more layers were shaded
+    bool overdraw = false;
+    unsigned int transformBuffer;
+    unsigned int transformTexture;
+    unsigned int visibleBuffer;
+    // Mirror of the buffer contents, compared against to find what changed
+    std::vector<SpriteInstance> instances;
+    std::vector<std::pair<std::size_t, std::size_t>> dirtyRanges;
+    // World space bounds of every sprite, rebuilt by prepare
+    std::vector<std::pair<glm::vec3, glm::vec3>> bounds;
+    std::vector<std::uint8_t> opaque;
+    std::vector<SortedSprite> opaqueVisible;
+    std::vector<SortedSprite> translucentVisible;
+    std::vector<SortedSprite> staticTranslucentVisible;
+    std::vector<SpriteIndex> visible;
+    const VertexLayout instanceLayout = VertexLayout::of<SpriteIndex>(1);
+    std::size_t capacity = 0;
+    std::size_t cursor = 0;
+
+    SpriteBatchRenderer(std::shared_ptr<ShaderProgram> s, std::shared_ptr<TextureArray> t, std::shared_ptr<Camera> c,
+        std::shared_ptr<ShaderProgram> staticS = nullptr):
+        shader(s), textures(t), camera(c), staticShader(staticS) {
+        glGenBuffers(1, &transformBuffer);
+        glGenTextures(1, &transformTexture);
+        glGenBuffers(1, &visibleBuffer);
+        hullFan = std::make_unique<VertexArray>(VertexLayout{});
+        hullFan->setIndices(hullFanIndices(1));
+        hullFan->addBuffer(visibleBuffer, instanceLayout);
+        if (staticShader)
+            staticVertices = std::make_unique<VertexArray>(VertexLayout::of<StaticSpriteVertex>());
+    }
+    ~SpriteBatchRenderer() {
+        glDeleteBuffers(1, &visibleBuffer);
+        glDeleteTextures(1, &transformTexture);
+        glDeleteBuffers(1, &transformBuffer);
+    }
+
     virtual void DrawEntity(const Sprite& sprite) {
-        mesh->setTexture(sprite.texture);
-        auto zIndex = sprite.transform[3][2];
-        mesh->shader->use()->setUniform1f("zIndex", zIndex)->setUniformMat4("model", sprite.transform);
-        camera->applyToShader(*(mesh->shader));
-        mesh->draw();
+        int layer = textures->layerOf(sprite.texture.get());
+        if (layer < 0)
+            layer = textures->add(sprite.texture);
+        // Sprites without a layer collapse to nothing so buffer slots keep matching entities
+        SpriteInstance instance{ layer < 0 ? glm::mat4(0.0f) : sprite.transform, glm::vec4(float(layer)) };
+        std::size_t index = cursor++;
+        opaque[index] = sprite.texture->alphaMode == AlphaMode::Opaque;
+
+        // The unit quad spans half a unit along the model's x and y axes
+        auto& m = instance.model;
+        glm::vec3 extent(
+            0.5f * (std::abs(m[0][0]) + std::abs(m[1][0])),
+            0.5f * (std::abs(m[0][1]) + std::abs(m[1][1])),
+            0.5f * (std::abs(m[0][2]) + std::abs(m[1][2]))
+        );
+        glm::vec3 center(m[3][0], m[3][1], m[3][2]);
+        bounds[index] = {
+            glm::vec3(center.x - extent.x, center.y - extent.y, center.z - extent.z),
+            glm::vec3(center.x + extent.x, center.y + extent.y, center.z + extent.z)
+        };
+
+        if (std::memcmp(&instances[index], &instance, sizeof(SpriteInstance)) == 0)
+            return;
+        instances[index] = instance;
+        if (!dirtyRanges.empty() && dirtyRanges.back().second == index)
+            dirtyRanges.back().second++;
+        else
+            dirtyRanges.push_back({ index, index + 1 });
+    }
+
+    template<typename ... Ts>
+    void add(Ts ... args) {
+        Sprite sprite(args...);
+        if (sprite.isStatic && staticShader) {
+            staticSprites.push_back(std::move(sprite));
+            staticDirty = true;
+        }
+        else {
+            entities.push_back(std::move(sprite));
+        }
+    }
+
+    void invalidateStatic() {
+        staticDirty = true;
+    }
+
+    // Rebuilds the static vertex buffer, prepare does this when the static set changed
+    void bakeStatic() {
+        staticDirty = false;
+        bakedTextures.clear();
+        struct Placed {
+            bool translucent;
+            glm::ivec2 cell;
+            const Sprite* sprite;
+            int layer;
+        };
+        std::vector<Placed> placed;
+        placed.reserve(staticSprites.size());
+        for (auto& sprite : staticSprites) {
+            int layer = textures->layerOf(sprite.texture.get());
+            if (layer < 0)
+                layer = textures->add(sprite.texture);
+            if (layer < 0)
+                continue;
+            bakedTextures[sprite.texture.get()] = { sprite.texture->alphaMode, sprite.texture->hull };
+            auto& origin = sprite.transform[3];
+            glm::ivec2 cell(int(std::floor(origin.x / cellSize)), int(std::floor(origin.y / cellSize)));
+            placed.push_back({ sprite.texture->alphaMode != AlphaMode::Opaque, cell, &sprite, layer });
+        }
+        // Opaque cells first. Translucent sprites are sorted per draw, baking them lowest z first keeps
+        // them in order already for cameras looking down -z like the 2D ones.
+        std::sort(placed.begin(), placed.end(), [](const Placed& a, const Placed& b) {
+            if (a.translucent != b.translucent)
+                return b.translucent;
+            if (a.translucent && a.sprite->transform[3][2] != b.sprite->transform[3][2])
+                return a.sprite->transform[3][2] < b.sprite->transform[3][2];
+            if (a.cell.y != b.cell.y)
+                return a.cell.y < b.cell.y;
+            if (a.cell.x != b.cell.x)
+                return a.cell.x < b.cell.x;
+            return a.sprite->transform[3][2] < b.sprite->transform[3][2];
+        });
+
+        // Each sprite is its texture's hull, uvs map onto the unit quad
+        std::vector<StaticSpriteVertex> vertices;
+        vertices.reserve(placed.size() * Texture::hullVertexCount);
+        staticCells.clear();
+        staticTranslucent.clear();
+        for (std::size_t i = 0; i < placed.size(); i++) {
+            glm::vec3 min(INFINITY), max(-INFINITY);
+            for (auto& corner : placed[i].sprite->texture->hullCorners()) {
+                glm::vec4 world = placed[i].sprite->transform * glm::vec4(corner.x - 0.5f, corner.y - 0.5f, 0.0f, 1.0f);
+                glm::vec3 position(world.x, world.y, world.z);
+                vertices.push_back({ position, glm::vec3(corner.x, corner.y, float(placed[i].layer)) });
+                min = glm::vec3(std::min(min.x, position.x), std::min(min.y, position.y), std::min(min.z, position.z));
+                max = glm::vec3(std::max(max.x, position.x), std::max(max.y, position.y), std::max(max.z, position.z));
+            }
+            if (placed[i].translucent) {
+                staticTranslucent.push_back({ min, max, i });
+                continue;
+            }
+            if (i == 0 || placed[i].cell != placed[i - 1].cell)
+                staticCells.push_back({ glm::vec3(INFINITY), glm::vec3(-INFINITY), i, 0 });
+            auto& cell = staticCells.back();
+            cell.spriteCount++;
+            cell.min = glm::vec3(std::min(cell.min.x, min.x), std::min(cell.min.y, min.y), std::min(cell.min.z, min.z));
+            cell.max = glm::vec3(std::max(cell.max.x, max.x), std::max(cell.max.y, max.y), std::max(cell.max.z, max.z));
+        }
+        staticVertices->setVertices(vertices);
+        staticVertices->setIndices(hullFanIndices(placed.size()));
+    }
+
+    static constexpr std::size_t fanIndexCount = (Texture::hullVertexCount - 2) * 3;
+
+    void useStatic(Camera& view) {
+        staticShader->use()
+            ->setUniform1i("sprites", 0)
+            ->setUniform1i("overdraw", overdraw);
+        view.use();
+        textures->bind(0);
+    }
+
+    // Draws the opaque static cells view can see, neighbouring visible cells go out as one range
+    void drawStaticOpaque(Camera& view) {
+        if (staticCells.empty())
+            return;
+        useStatic(view);
+        std::size_t first = 0;
+        std::size_t count = 0;
+        for (auto& cell : staticCells) {
+            if (!view.isVisible(cell.min, cell.max))
+                continue;
+            if (count > 0 && first + count == cell.firstSprite) {
+                count += cell.spriteCount;
+                continue;
+            }
+            if (count > 0)
+                staticVertices->drawRange(first * fanIndexCount, count * fanIndexCount);
+            first = cell.firstSprite;
+            count = cell.spriteCount;
+        }
+        if (count > 0)
+            staticVertices->drawRange(first * fanIndexCount, count * fanIndexCount);
+    }
+
+    // Uploads the sprites that changed, once per frame before any camera draws
+    void prepare() {
+        for (auto& [texture, baked] : bakedTextures) {
+            staticDirty = staticDirty || texture->alphaMode != baked.first || texture->hull != baked.second;
+        }
+        if (staticDirty)
+            bakeStatic();
+        textures->refresh();
+        glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer);
+        if (entities.size() > capacity) {
+            // Grown storage starts out undefined, NaN placeholders never match a real sprite so all get uploaded
+            capacity = entities.size() * 2;
+            glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(SpriteInstance), nullptr, GL_DYNAMIC_DRAW);
+            instances.assign(capacity, SpriteInstance{ glm::mat4(NAN), glm::vec4(NAN) });
+            glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transformBuffer);
+        }
+        bounds.resize(entities.size());
+        opaque.resize(entities.size());
+        cursor = 0;
+        dirtyRanges.clear();
+        Renderer<Sprite>::Render();
+        for (auto [begin, end] : dirtyRanges) {
+            glBufferSubData(GL_TEXTURE_BUFFER, begin * sizeof(SpriteInstance), (end - begin) * sizeof(SpriteInstance), &instances[begin]);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Draws the sprites view can see, prepare must have run this frame
+    void draw(Camera& view) {
+        opaqueVisible.clear();
+        translucentVisible.clear();
+        for (std::size_t i = 0; i < bounds.size(); i++) {
+            auto& [min, max] = bounds[i];
+            if (!view.isVisible(min, max))
+                continue;
+            // Distance in front of the camera along its view direction
+            glm::vec4 center = view.view * glm::vec4((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f, 1.0f);
+            SortedSprite sorted{ -center.z, { std::uint32_t(i) } };
+            if (opaque[i])
+                opaqueVisible.push_back(sorted);
+            else
+                translucentVisible.push_back(sorted);
+        }
+        std::sort(opaqueVisible.begin(), opaqueVisible.end(), [](const SortedSprite& a, const SortedSprite& b) {
+            return a.depth < b.depth;
+        });
+        std::sort(translucentVisible.begin(), translucentVisible.end(), [](const SortedSprite& a, const SortedSprite& b) {
+            return a.depth > b.depth;
+        });
+        visible.clear();
+        for (auto& sorted : opaqueVisible) {
+            visible.push_back(sorted.index);
+        }
+        for (auto& sorted : translucentVisible) {
+            visible.push_back(sorted.index);
+        }
+        if (!visible.empty()) {
+            glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+            // Orphaned per draw, several cameras can draw the batch in one frame
+            glBufferData(GL_ARRAY_BUFFER, sizeof(SpriteIndex) * visible.size(), visible.data(), GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        GLboolean blending = glIsEnabled(GL_BLEND);
+        GLint blendSource, blendDestination;
+        glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource);
+        glGetIntegerv(GL_BLEND_DST_RGB, &blendDestination);
+        if (overdraw) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+        }
+
+        // Opaque pass, dynamic sprites nearest first then the static cells behind them
+        if (!overdraw)
+            glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+        drawDynamic(view, 0, opaqueVisible.size());
+        if (staticShader)
+            drawStaticOpaque(view);
+
+        // Translucent pass, baked and dynamic sprites together furthest first
+        if (!overdraw) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+        glDepthMask(GL_FALSE);
+        drawTranslucent(view);
+
+        glDepthMask(GL_TRUE);
+        if (blending)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+        glBlendFunc(blendSource, blendDestination);
+    }
+
+    // Merges the visible translucent static sprites into the sorted dynamic ones. Each run of one kind is
+    // a draw call, baked sprites next to each other in the buffer share one.
+    void drawTranslucent(Camera& view) {
+        staticTranslucentVisible.clear();
+        if (staticShader) {
+            for (auto& sprite : staticTranslucent) {
+                if (!view.isVisible(sprite.min, sprite.max))
+                    continue;
+                auto& min = sprite.min;
+                auto& max = sprite.max;
+                glm::vec4 center = view.view * glm::vec4((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f, 1.0f);
+                staticTranslucentVisible.push_back({ -center.z, { std::uint32_t(sprite.index) } });
+            }
+            // Usually sorted already, see bakeStatic. Stable so equal depths keep their baked order.
+            std::stable_sort(staticTranslucentVisible.begin(), staticTranslucentVisible.end(), [](const SortedSprite& a, const SortedSprite& b) {
+                return a.depth > b.depth;
+            });
+        }
+
+        std::size_t dynamic = 0;
+        std::size_t baked = 0;
+        while (dynamic < translucentVisible.size() || baked < staticTranslucentVisible.size()) {
+            // At equal depth baked sprites go first, they are the background
+            bool staticNext = baked < staticTranslucentVisible.size() &&
+                (dynamic == translucentVisible.size() || staticTranslucentVisible[baked].depth >= translucentVisible[dynamic].depth);
+            if (!staticNext) {
+                std::size_t first = dynamic;
+                while (dynamic < translucentVisible.size() &&
+                    (baked == staticTranslucentVisible.size() || translucentVisible[dynamic].depth > staticTranslucentVisible[baked].depth))
+                    dynamic++;
+                drawDynamic(view, opaqueVisible.size() + first, dynamic - first);
+                continue;
+            }
+            useStatic(view);
+            while (baked < staticTranslucentVisible.size() &&
+                (dynamic == translucentVisible.size() || staticTranslucentVisible[baked].depth >= translucentVisible[dynamic].depth)) {
+                std::size_t first = staticTranslucentVisible[baked].index.sprite;
+                std::size_t count = 1;
+                baked++;
+                while (baked < staticTranslucentVisible.size() && staticTranslucentVisible[baked].index.sprite == first + count &&
+                    (dynamic == translucentVisible.size() || staticTranslucentVisible[baked].depth >= translucentVisible[dynamic].depth)) {
+                    count++;
+                    baked++;
+                }
+                staticVertices->drawRange(first * fanIndexCount, count * fanIndexCount);
+            }
+        }
+    }
+
+    // Draws count entries of the uploaded visible list starting at first
+    void drawDynamic(Camera& view, std::size_t first, std::size_t count) {
+        if (count == 0)
+            return;
+        // Without base instance support the per instance attribute is pointed part way into the buffer
+        hullFan->addBuffer(visibleBuffer, instanceLayout, first * sizeof(SpriteIndex));
+        shader->use()
+            ->setUniform1i("sprites", 0)
+            ->setUniform1i("transforms", 1)
+            ->setUniform1i("hulls", 2)
+            ->setUniform1i("overdraw", overdraw);
+        view.use();
+        textures->bind(0);
+        textures->bindHulls(2);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+        hullFan->drawInstanced(count);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void Render() {
+        prepare();
+        draw(*camera);
     }
 };
 
@@ -56,56 +502,77 @@ struct TextLine {
     RenderableId id;
     std::string text;
     glm::mat4 transform;
+    LayoutOptions options;
     std::vector<std::vector<float>> UVs;
     std::vector<std::vector<float>> Positions;
-    std::shared_ptr<FontAtlas> font;
-    TextLine(RenderableId _id, std::string _text, glm::mat4 _transform, std::shared_ptr<FontAtlas> f):
-        id(_id), text(_text), transform(_transform), font(f), UVs(), Positions() {
-        UVs.reserve(_text.length());
-        Positions.reserve(_text.length());
-        float x = 0, y = 0;
-        float lastX = 0;
-        for (auto& ch : _text) {
-            auto glyphData = font->renderChar(ch, &x, &y);
+    std::shared_ptr<GlyphAtlas> font;
+    std::shared_ptr<TextLayoutCache> layoutCache;
+    std::shared_ptr<const GlyphRun> run;
+    std::uint64_t atlasGeneration = 0;
+    TextLine(RenderableId _id, std::string _text, glm::mat4 _transform, LayoutOptions _options, std::shared_ptr<GlyphAtlas> f, std::shared_ptr<TextLayoutCache> cache):
+        id(_id), text(_text), transform(_transform), options(_options), font(f), layoutCache(cache), UVs(), Positions() {
+        layout();
+    }
+    TextLine(RenderableId _id, std::string _text, glm::mat4 _transform, std::shared_ptr<GlyphAtlas> f, std::shared_ptr<TextLayoutCache> cache):
+        TextLine(_id, _text, _transform, LayoutOptions{}, f, cache) {}
+
+    void layout() {
+        run = layoutCache->get(*font, text, options);
+        atlasGeneration = run->generation;
+        UVs.clear();
+        Positions.clear();
+        UVs.reserve(run->glyphs.size());
+        Positions.reserve(run->glyphs.size());
+        float divisor = font->size;
+        for (auto& glyph : run->glyphs) {
+            auto& glyphData = glyph.quad;
+            // One quad per glyph, the mesh indexes it as two triangles
             UVs.push_back({
                 glyphData.s1, glyphData.t1,
                 glyphData.s1, glyphData.t0,
                 glyphData.s0, glyphData.t1,
-                // second triangle
-                glyphData.s1, glyphData.t0,
-                glyphData.s0, glyphData.t0,
-                glyphData.s0, glyphData.t1
+                glyphData.s0, glyphData.t0
             });
-            float divisor = font->size;
 
             Positions.push_back({
                 glyphData.x1 / divisor, glyphData.y1 / divisor,
                 glyphData.x1 / divisor, glyphData.y0 / divisor,
                 glyphData.x0 / divisor, glyphData.y1 / divisor,
-                // second triangle
-                glyphData.x1 / divisor, glyphData.y0 / divisor,
-                glyphData.x0 / divisor, glyphData.y0 / divisor,
-                glyphData.x0 / divisor, glyphData.y1 / divisor
+                glyphData.x0 / divisor, glyphData.y0 / divisor
             });
-
         }
     }
 };
 
 struct TextRenderer : public Renderer<TextLine> {
     std::unique_ptr<TexturedMesh> characterMesh;
-    std::shared_ptr<FontAtlas> font;
-    std::shared_ptr<PerspectiveCamera> camera;
-    TextRenderer(std::unique_ptr<TexturedMesh> m, std::shared_ptr<FontAtlas> f, std::shared_ptr<PerspectiveCamera> c) : characterMesh(std::move(m)), font(f), camera(c) {}
+    std::shared_ptr<GlyphAtlas> font;
+    std::shared_ptr<Camera> camera;
+    std::shared_ptr<TextLayoutCache> layoutCache;
+    TextRenderer(std::unique_ptr<TexturedMesh> m, std::shared_ptr<GlyphAtlas> f, std::shared_ptr<Camera> c) :
+        characterMesh(std::move(m)), font(f), camera(c), layoutCache(std::make_shared<TextLayoutCache>()) {}
+
+    void Render() {
+        camera->use();
+        font->nextFrame();
+        // Lines laid out before a glyph was evicted may reference reused atlas space,
+        // the rest only need their glyphs kept resident
+        for (auto& textLine : entities) {
+            if (textLine.atlasGeneration != font->generation) {
+                textLine.layout();
+                continue;
+            }
+            for (auto& glyph : textLine.run->glyphs) {
+                font->touch(glyph.codepoint);
+            }
+        }
+        Renderer<TextLine>::Render();
+    }
     
     virtual void DrawEntity(const TextLine& textLine) {
         auto zIndex = textLine.transform[3][2];
         auto pos = glm::mat4(textLine.transform);
-        float x = 0, y = 0;
-        float lastX = 0;
-        for (int i = 0; i < textLine.text.length(); ++i) {
-            auto& ch = textLine.text[i];
-            auto glyphData = font->renderChar(ch, &x, &y);
+        for (int i = 0; i < textLine.UVs.size(); ++i) {
             auto a = textLine.UVs[i];
             characterMesh->UV = a;
             characterMesh->updateUVs();
@@ -114,15 +581,15 @@ struct TextRenderer : public Renderer<TextLine> {
             characterMesh->updatePositions();
             characterMesh->shader->use()
                 ->setUniform1f("zIndex", zIndex)
+                ->setUniform1i("distanceField", font->distanceField)
                 ->setUniformMat4("model", pos);
             pos = glm::translate(pos, glm::vec3(0.0f, 0.0f, 1.0f));
-            camera->applyToShader(*(characterMesh->shader));
             characterMesh->draw();
         }
     }
     template<typename ... Ts>
     void add(Ts ... args) {
-        entities.push_back(TextLine(args..., font));
+        entities.push_back(TextLine(args..., font, layoutCache));
     }
 };
 
@@ -130,13 +597,11 @@ struct TextRenderer : public Renderer<TextLine> {
 struct TypeWriterRenderer : public TextRenderer {
     int frames = 0;
     int length = 0;
-    TypeWriterRenderer(std::unique_ptr<TexturedMesh> m, std::shared_ptr<FontAtlas> f, std::shared_ptr<PerspectiveCamera> c):
+    TypeWriterRenderer(std::unique_ptr<TexturedMesh> m, std::shared_ptr<GlyphAtlas> f, std::shared_ptr<Camera> c):
         TextRenderer(std::move(m), f, c) {}
     virtual void DrawEntity(const TextLine& textLine) {
         auto zIndex = textLine.transform[3][2];
         auto pos = glm::mat4(textLine.transform);
-        float x = 0, y = 0;
-        float lastX = 0;
         // Todo: replace this with something sensible
         frames++;
         if (frames < 0)
@@ -144,10 +609,8 @@ struct TypeWriterRenderer : public TextRenderer {
         if (frames % 60 == 0) {
             length++;
         }
-        int maxSize = textLine.text.length();
+        int maxSize = textLine.UVs.size();
         for (int i = 0; i < maxSize && i < (length % maxSize); ++i) {
-            auto& ch = textLine.text[i];
-            auto glyphData = font->renderChar(ch, &x, &y);
             auto a = textLine.UVs[i];
             characterMesh->UV = a;
             characterMesh->updateUVs();
@@ -156,9 +619,9 @@ struct TypeWriterRenderer : public TextRenderer {
             characterMesh->updatePositions();
             characterMesh->shader->use()
                 ->setUniform1f("zIndex", zIndex)
+                ->setUniform1i("distanceField", font->distanceField)
                 ->setUniformMat4("model", pos);
             pos = glm::translate(pos, glm::vec3(0.0f, 0.0f, 1.0f));
-            camera->applyToShader(*(characterMesh->shader));
             characterMesh->draw();
         }
     }
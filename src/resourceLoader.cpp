@@ -1,31 +1,160 @@
 #include "resourceLoader.h"
+#include "utils.h"
 
 SoundLoader::SoundLoader(shared_ptr<SoLoud::Soloud> soloudptr) : ResourceLoader(), soloud(soloudptr) {}
-shared_ptr<SoLoud::Wav> SoundLoader::fetch(path p) {
-	auto wav = std::make_shared<SoLoud::Wav>();
+shared_ptr<SoLoud::AudioSource> SoundLoader::fetch(path p) {
 	auto pathStr = p.string();
 	const char* rawPath = pathStr.c_str();
-	wav->load(rawPath);
+	std::error_code error;
+	auto fileSize = std::filesystem::file_size(p, error);
+	if (!error && fileSize >= streamThreshold) {
+		auto stream = std::make_shared<SoLoud::WavStream>();
+		if (stream->load(rawPath) != SoLoud::SO_NO_ERROR)
+			std::cout << "failed to open sound stream " << pathStr << std::endl;
+		return stream;
+	}
+	auto wav = std::make_shared<SoLoud::Wav>();
+	if (wav->load(rawPath) != SoLoud::SO_NO_ERROR)
+		std::cout << "failed to load sound " << pathStr << std::endl;
 	return wav;
 }
 
+std::size_t SoundLoader::sizeOf(const SoLoud::AudioSource& sound) const {
+	// Streams decode a small buffer at a time, only fully decoded sounds hold PCM
+	auto wav = dynamic_cast<const SoLoud::Wav*>(&sound);
+	if (wav == nullptr || evicted.count(wav))
+		return 0;
+	return std::size_t(wav->mSampleCount) * wav->mChannels * sizeof(float);
+}
+
+bool SoundLoader::isResident(const SoLoud::AudioSource& sound) const {
+	return evicted.count(&sound) == 0;
+}
+
+bool SoundLoader::isInUse(SoLoud::AudioSource& sound) {
+	// Voices read the samples directly, freeing them under a playing voice would cut it off
+	return soloud->countAudioSource(sound) > 0;
+}
+
+void SoundLoader::evict(SoLoud::AudioSource& sound) {
+	auto wav = dynamic_cast<SoLoud::Wav*>(&sound);
+	if (wav == nullptr)
+		return;
+	// Wav has no unload, loading a single copied sample frees the decoded data the way a reload would
+	float silence = 0.0f;
+	wav->loadRawWave(&silence, 1, wav->mBaseSamplerate, 1, true);
+	evicted.insert(wav);
+}
+
+void SoundLoader::restore(SoLoud::AudioSource& sound, const path& p) {
+	auto wav = dynamic_cast<SoLoud::Wav*>(&sound);
+	if (wav == nullptr)
+		return;
+	if (wav->load(p.string().c_str()) != SoLoud::SO_NO_ERROR) {
+		std::cout << "failed to load sound " << p.string() << std::endl;
+		return;
+	}
+	evicted.erase(wav);
+}
+
+void SoundLoader::load(const vector<pair<path, string>>& assetList) {
+	vector<shared_ptr<SoLoud::AudioSource>> loaded(assetList.size());
+	Parallel::forRange(assetList.size(), workerCount, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			loaded[i] = fetch(assetList[i].first);
+		}
+	});
+	for (std::size_t i = 0; i < assetList.size(); i++) {
+		sources[assetList[i].second] = assetList[i].first;
+		insert(assetList[i].second, loaded[i]);
+	}
+	std::cout << "Decoded sounds use " << getDecodedBytes() << " bytes" << std::endl;
+}
+
 
 TextureLoader::TextureLoader() : ResourceLoader() {}
 shared_ptr<ImageTexture> TextureLoader::fetch(path p) {
-	auto texture = std::make_shared<ImageTexture>(p);
+	// Offline compressed textures carry their own mip chain
+	shared_ptr<ImageTexture> texture;
+	if (p.extension() == ".ktx")
+		texture = std::make_shared<CompressedTexture>(p.lexically_normal());
+	else
+		texture = std::make_shared<ImageTexture>(p.lexically_normal());
 	texture->Init();
 	return texture;
 }
 
+void TextureLoader::stream(const vector<pair<path, string>>& assetList, TextureUploader& uploader) {
+	vector<ImageData> images(assetList.size());
+	Parallel::forRange(assetList.size(), workerCount, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			if (assetList[i].first.extension() != ".ktx")
+				images[i] = ImageTexture::Decode(assetList[i].first);
+		}
+	});
+	for (std::size_t i = 0; i < assetList.size(); i++) {
+		auto& [p, key] = assetList[i];
+		sources[key] = p;
+		// Compressed files are small enough to upload directly
+		if (p.extension() == ".ktx") {
+			insert(key, fetch(p));
+			continue;
+		}
+		auto texture = std::make_shared<ImageTexture>(p.lexically_normal());
+		texture->Allocate(images[i]);
+		uploader.enqueue(texture, std::move(images[i]));
+		insert(key, texture);
+	}
+}
+
+std::size_t TextureLoader::sizeOf(const ImageTexture& texture) const {
+	return texture.gpuBytes();
+}
+
+bool TextureLoader::isResident(const ImageTexture& texture) const {
+	return texture.textureId != 0;
+}
+
+void TextureLoader::evict(ImageTexture& texture) {
+	texture.unload();
+}
+
+void TextureLoader::restore(ImageTexture& texture, const path& p) {
+	texture.Init();
+}
+
+bool TextureLoader::uses(const path& p) {
+	bool found = false;
+	forEach([&](const string& key, const shared_ptr<ImageTexture>& texture) {
+		found = found || texture->path == p.string();
+	});
+	return found;
+}
+
+void TextureLoader::reload(const path& p, const ImageData& image) {
+	if (!image.pixels)
+		return;
+	forEach([&](const string& key, const shared_ptr<ImageTexture>& texture) {
+		if (texture->path != p.string())
+			return;
+		ImageTexture replacement{ p };
+		replacement.srgb = texture->srgb;
+		replacement.Init(image);
+		texture->swap(replacement);
+		texture->channels = replacement.channels;
+		std::cout << "Reloaded texture " << key << std::endl;
+	});
+}
+
 
 ShaderLoader::ShaderLoader() : SharedResourceMap() {}
-shared_ptr<ShaderProgram> ShaderLoader::fetch(path vertexPath, path fragPath) {
+shared_ptr<ShaderProgram> ShaderLoader::build(const string& vertexSource, const string& fragmentSource) {
 	auto vertex = std::make_unique<Shader>(
-		FS::readFile(vertexPath),
+		vertexSource,
 		GL_VERTEX_SHADER
 		);
 	auto fragment = std::make_unique<Shader>(
-		FS::readFile(fragPath),
+		fragmentSource,
 		GL_FRAGMENT_SHADER
 		);
 
@@ -33,9 +162,43 @@ shared_ptr<ShaderProgram> ShaderLoader::fetch(path vertexPath, path fragPath) {
 	return shader;
 }
 
+shared_ptr<ShaderProgram> ShaderLoader::fetch(path vertexPath, path fragPath) {
+	return build(FS::readFile(vertexPath), FS::readFile(fragPath));
+}
+
 void ShaderLoader::load(const vector<pair<pair<path, path>, string>>& assetList) {
 	for (auto [paths, key] : assetList) {
 		auto [vertex, fragment] = paths;
-		map.insert({ key, fetch(vertex, fragment) });
+		sources[key] = { vertex.lexically_normal(), fragment.lexically_normal() };
+		insert(key, fetch(vertex, fragment));
+	}
+}
+
+bool ShaderLoader::uses(const path& p) {
+	for (auto& [key, paths] : sources) {
+		if (paths.first == p || paths.second == p)
+			return true;
+	}
+	return false;
+}
+
+void ShaderLoader::reload(const path& p, const string& source) {
+	for (auto& [key, paths] : sources) {
+		auto [vertexPath, fragmentPath] = paths;
+		if (vertexPath != p && fragmentPath != p)
+			continue;
+		auto existing = find(key);
+		if (!existing)
+			continue;
+		auto replacement = build(
+			vertexPath == p ? source : FS::readFile(vertexPath),
+			fragmentPath == p ? source : FS::readFile(fragmentPath)
+		);
+		if (!replacement->linked) {
+			std::cout << "Keeping previous version of shader " << key << std::endl;
+			continue;
+		}
+		existing->swap(*replacement);
+		std::cout << "Reloaded shader " << key << std::endl;
 	}
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <filesystem>
 #include <string>
@@ -7,13 +8,21 @@
 #include <vector>
 #include <utility>
 #include <optional>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
 
 #include "soloud.h"
 #include "soloud_wav.h"
+#include "soloud_wavstream.h"
 
 #include "shader.h"
 #include "fs.h"
 #include "texture.h"
+#include "textureUpload.h"
 
 
 using std::string;
@@ -24,49 +33,315 @@ using std::shared_ptr;
 using std::pair;
 using std::optional;
 
+// 64 bit FNV-1a hash of an asset key, usable at compile time through the _rid literal
+struct ResourceId {
+	uint64_t value = 0;
+	constexpr ResourceId() = default;
+	constexpr ResourceId(std::string_view key) : value(hash(key)) {}
+	constexpr bool operator==(const ResourceId& other) const { return value == other.value; }
+
+	static constexpr uint64_t hash(std::string_view key) {
+		uint64_t h = 0xcbf29ce484222325ull;
+		for (char c : key) {
+			h ^= (unsigned char)c;
+			h *= 0x100000001b3ull;
+		}
+		return h;
+	}
+};
+
+constexpr ResourceId operator""_rid(const char* key, std::size_t length) {
+	return ResourceId(std::string_view(key, length));
+}
+
+template <typename ResourceType>
+struct ResourceEntry {
+	ResourceId id;
+	string name;
+	shared_ptr<ResourceType> resource;
+	// Tick of the last lookup, drives eviction order
+	mutable std::atomic<uint64_t> lastUsed = 0;
+};
+
+// Non-owning view of a registered resource, valid for as long as the registry that produced it.
+// Copying one never touches the shared_ptr refcount.
+template <typename ResourceType>
+class ResourceHandle {
+	const ResourceEntry<ResourceType>* entry = nullptr;
+public:
+	ResourceHandle() = default;
+	explicit ResourceHandle(const ResourceEntry<ResourceType>* e) : entry(e) {}
+
+	ResourceType* get() const { return entry ? entry->resource.get() : nullptr; }
+	ResourceType* operator->() const { return get(); }
+	ResourceType& operator*() const { return *get(); }
+	explicit operator bool() const { return entry != nullptr; }
+
+	// For callers that need to keep the resource beyond the registry
+	const shared_ptr<ResourceType>& shared() const { return entry->resource; }
+	const string& name() const { return entry->name; }
+	uint64_t lastUsed() const { return entry->lastUsed.load(std::memory_order_relaxed); }
+	void markUsed(uint64_t tick) const { entry->lastUsed.store(tick, std::memory_order_relaxed); }
+};
+
+// Registry that is safe to read from any thread while one thread inserts.
+// Lookups probe an open addressing table without taking a lock and stamp the entry with a tick from a
+// shared atomic clock, so eviction sees what any thread used. Inserts are serialized and publish
+// a doubled table when it fills up. Replaced tables are kept until destruction since readers may
+// still be probing them.
 template <typename ResourceType>
 struct SharedResourceMap {
-	SharedResourceMap() = default;
-	unordered_map<string, shared_ptr<ResourceType>> map;
-	optional<shared_ptr<ResourceType>> get(string key) {
-		auto resource = map.find(key);
-		if (resource != map.end()) {
-			return resource->second;
+	using Entry = ResourceEntry<ResourceType>;
+	using Handle = ResourceHandle<ResourceType>;
+private:
+	struct Table {
+		std::size_t mask;
+		std::unique_ptr<std::atomic<const Entry*>[]> slots;
+		explicit Table(std::size_t capacity) : mask(capacity - 1), slots(new std::atomic<const Entry*>[capacity]) {
+			for (std::size_t i = 0; i <= mask; i++) {
+				slots[i].store(nullptr, std::memory_order_relaxed);
+			}
+		}
+	};
+	std::atomic<Table*> table;
+	vector<std::unique_ptr<Table>> tables;
+	vector<std::unique_ptr<Entry>> entries;
+	std::mutex writeMutex;
+	mutable std::atomic<uint64_t> clock = 0;
+
+	static void place(Table& t, const Entry* entry) {
+		for (std::size_t i = entry->id.value & t.mask;; i = (i + 1) & t.mask) {
+			if (t.slots[i].load(std::memory_order_relaxed) == nullptr) {
+				t.slots[i].store(entry, std::memory_order_release);
+				return;
+			}
+		}
+	}
+public:
+	SharedResourceMap() {
+		tables.push_back(std::make_unique<Table>(16));
+		table.store(tables.back().get(), std::memory_order_release);
+	}
+	SharedResourceMap(const SharedResourceMap&) = delete;
+	SharedResourceMap& operator=(const SharedResourceMap&) = delete;
+
+	Handle find(ResourceId id) const {
+		const Table* t = table.load(std::memory_order_acquire);
+		for (std::size_t i = id.value & t->mask;; i = (i + 1) & t->mask) {
+			const Entry* entry = t->slots[i].load(std::memory_order_acquire);
+			if (entry == nullptr)
+				return Handle();
+			if (entry->id == id) {
+				Handle handle(entry);
+				handle.markUsed(clock.fetch_add(1, std::memory_order_relaxed) + 1);
+				return handle;
+			}
+		}
+	}
+
+	Handle find(std::string_view key) const {
+		return find(ResourceId(key));
+	}
+
+	// Keeps the existing resource if the key is already registered
+	Handle insert(const string& key, shared_ptr<ResourceType> resource) {
+		std::lock_guard<std::mutex> lock(writeMutex);
+		ResourceId id(key);
+		if (auto existing = find(id)) {
+			if (existing.name() != key)
+				throw std::runtime_error("Resource id collision between " + key + " and " + existing.name());
+			return existing;
+		}
+		Table* current = table.load(std::memory_order_relaxed);
+		if ((entries.size() + 1) * 2 > current->mask + 1) {
+			tables.push_back(std::make_unique<Table>((current->mask + 1) * 2));
+			current = tables.back().get();
+			for (auto& entry : entries) {
+				place(*current, entry.get());
+			}
+			table.store(current, std::memory_order_release);
+		}
+		auto entry = std::make_unique<Entry>();
+		entry->id = id;
+		entry->name = key;
+		entry->resource = std::move(resource);
+		entries.push_back(std::move(entry));
+		place(*current, entries.back().get());
+		return Handle(entries.back().get());
+	}
+
+	optional<shared_ptr<ResourceType>> get(const string& key) const {
+		if (auto handle = find(key)) {
+			return handle.shared();
 		}
 		return {};
 	};
+
+	// Visits every resource visible to a lookup made right now
+	template <typename Fn>
+	void forEach(Fn&& fn) const {
+		forEachHandle([&fn](const Handle& handle) {
+			fn(handle.name(), handle.shared());
+		});
+	}
+
+	template <typename Fn>
+	void forEachHandle(Fn&& fn) const {
+		const Table* t = table.load(std::memory_order_acquire);
+		for (std::size_t i = 0; i <= t->mask; i++) {
+			if (const Entry* entry = t->slots[i].load(std::memory_order_acquire))
+				fn(Handle(entry));
+		}
+	}
+
+	// Latest tick handed out by a lookup
+	uint64_t now() const {
+		return clock.load(std::memory_order_relaxed);
+	}
+
+	std::size_t count() const {
+		std::size_t total = 0;
+		forEachHandle([&total](const Handle&) { total++; });
+		return total;
+	}
 };
 
+// Loads resources by path and keeps track of how much memory they hold. Resources nobody else
+// references can be evicted to stay under a budget and are restored the next time they are acquired.
 template <typename ResourceType>
 class ResourceLoader: public SharedResourceMap<ResourceType> {
+	using Handle = typename SharedResourceMap<ResourceType>::Handle;
 	virtual shared_ptr<ResourceType> fetch(path path) = 0;
+	// Clock at the last trim, anything looked up since then on any thread is kept for at least one more
+	uint64_t trimmedAt = 0;
+
+protected:
+	unordered_map<string, path> sources;
+
+	// Eviction hooks, the defaults describe a resource that can't be evicted
+	virtual std::size_t sizeOf(const ResourceType& resource) const { return 0; }
+	virtual bool isResident(const ResourceType& resource) const { return true; }
+	// For uses the shared_ptr refcount can't see, like handles or playing voices
+	virtual bool isInUse(ResourceType& resource) { return false; }
+	virtual void evict(ResourceType& resource) {}
+	virtual void restore(ResourceType& resource, const path& p) {}
 
 public:
 	ResourceLoader() : SharedResourceMap<ResourceType>() {}
 	
 	void load(const vector<pair<path, string>>& assetList) {
 		for (auto [path, key] : assetList) {
-			this->map.insert({ key, fetch(path) });
+			sources[key] = path;
+			this->insert(key, fetch(path));
 		}
 	};
+
+	// Looks a resource up on the GL thread, bringing it back if it was evicted. Other threads use the
+	// lock free find, which marks the resource used but can't restore it.
+	Handle acquire(ResourceId id) {
+		auto handle = this->find(id);
+		if (handle && !isResident(*handle)) {
+			std::cout << "Restoring evicted resource " << handle.name() << std::endl;
+			restore(*handle, sources[handle.name()]);
+		}
+		return handle;
+	}
+
+	Handle acquire(std::string_view key) {
+		return acquire(ResourceId(key));
+	}
+
+	optional<shared_ptr<ResourceType>> get(const string& key) {
+		if (auto handle = acquire(key)) {
+			return handle.shared();
+		}
+		return {};
+	}
+
+	std::size_t residentBytes() const {
+		std::size_t total = 0;
+		this->forEachHandle([&](const Handle& handle) {
+			total += sizeOf(*handle);
+		});
+		return total;
+	}
+
+	// Evicts least recently used resources that only the registry references and that weren't looked
+	// up since the last trim, until the resident size fits the budget. Returns the resident size afterwards.
+	std::size_t trim(std::size_t budget) {
+		std::size_t total = residentBytes();
+		uint64_t pinnedAfter = trimmedAt;
+		trimmedAt = this->now();
+		if (total <= budget)
+			return total;
+		vector<Handle> candidates;
+		this->forEachHandle([&](const Handle& handle) {
+			if (handle.shared().use_count() == 1 && handle.lastUsed() <= pinnedAfter && sizeOf(*handle) > 0 && !isInUse(*handle))
+				candidates.push_back(handle);
+		});
+		std::sort(candidates.begin(), candidates.end(), [](const Handle& a, const Handle& b) {
+			return a.lastUsed() < b.lastUsed();
+		});
+		for (auto& handle : candidates) {
+			if (total <= budget)
+				break;
+			total -= sizeOf(*handle);
+			std::cout << "Evicting resource " << handle.name() << std::endl;
+			evict(*handle);
+		}
+		return total;
+	}
 };
 
-class SoundLoader : public ResourceLoader<SoLoud::Wav> {
+// Short effects are fully decoded into memory, anything at or above streamThreshold bytes on disk
+// is played back through a WavStream instead
+class SoundLoader : public ResourceLoader<SoLoud::AudioSource> {
 	shared_ptr<SoLoud::Soloud> soloud;
-	shared_ptr<SoLoud::Wav> fetch(path p) override;
+	// Sounds whose samples were freed, they hold a single silent sample until restored
+	std::unordered_set<const SoLoud::AudioSource*> evicted;
+	shared_ptr<SoLoud::AudioSource> fetch(path p) override;
+protected:
+	std::size_t sizeOf(const SoLoud::AudioSource& sound) const override;
+	bool isResident(const SoLoud::AudioSource& sound) const override;
+	bool isInUse(SoLoud::AudioSource& sound) override;
+	void evict(SoLoud::AudioSource& sound) override;
+	void restore(SoLoud::AudioSource& sound, const path& p) override;
 public:
+	std::uintmax_t streamThreshold = 1 << 20;
+	unsigned int workerCount = std::thread::hardware_concurrency();
 	SoundLoader(shared_ptr<SoLoud::Soloud> soloudptr);
+	// Decodes the list on worker threads, returns once every sound is ready
+	void load(const vector<pair<path, string>>& assetList);
+	// Bytes of PCM held by fully decoded sounds
+	std::size_t getDecodedBytes() const { return residentBytes(); }
 };
 
 class TextureLoader : public ResourceLoader<ImageTexture> {
 	shared_ptr<ImageTexture> fetch(path p) override;
+protected:
+	std::size_t sizeOf(const ImageTexture& texture) const override;
+	bool isResident(const ImageTexture& texture) const override;
+	void evict(ImageTexture& texture) override;
+	void restore(ImageTexture& texture, const path& p) override;
 public:
+	unsigned int workerCount = std::thread::hardware_concurrency();
 	TextureLoader();
+	// Decodes the list on worker threads and registers the textures right away, their pixels
+	// arrive over the next frames through uploader
+	void stream(const vector<pair<path, string>>& assetList, TextureUploader& uploader);
+	bool uses(const path& p);
+	// Uploads an already decoded image for every texture loaded from p, must run on the GL thread
+	void reload(const path& p, const ImageData& image);
 };
 
 class ShaderLoader : public SharedResourceMap<ShaderProgram> {
+	unordered_map<string, pair<path, path>> sources;
+	shared_ptr<ShaderProgram> build(const string& vertexSource, const string& fragmentSource);
 	shared_ptr<ShaderProgram> fetch(path vertexPath, path fragPath);
 public:
 	ShaderLoader();
 	void load(const vector<pair<pair<path, path>, string>>& assetList);
+	bool uses(const path& p);
+	// Relinks every program built from p, keeping the old program if the new one fails to compile
+	void reload(const path& p, const string& source);
 };
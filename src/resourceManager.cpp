@@ -0,0 +1,20 @@
+#include "resourceManager.h"
+
+ResourceManager::ResourceManager(TextureLoader& textureLoader, SoundLoader& soundLoader, ShaderLoader& shaderLoader, MemoryBudget b) :
+	textures(textureLoader), sounds(soundLoader), shaders(shaderLoader), budget(b) {}
+
+MemoryReport ResourceManager::report() const {
+	MemoryReport memory;
+	memory.textureBytes = textures.residentBytes();
+	memory.soundBytes = sounds.residentBytes();
+	memory.shaderCount = shaders.count();
+	return memory;
+}
+
+MemoryReport ResourceManager::collect() {
+	MemoryReport memory;
+	memory.textureBytes = textures.trim(budget.textureBytes);
+	memory.soundBytes = sounds.trim(budget.soundBytes);
+	memory.shaderCount = shaders.count();
+	return memory;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+#include "resourceLoader.h"
+
+struct MemoryBudget {
+	std::size_t textureBytes = std::size_t(256) << 20;
+	std::size_t soundBytes = std::size_t(64) << 20;
+};
+
+struct MemoryReport {
+	std::size_t textureBytes = 0;
+	std::size_t soundBytes = 0;
+	std::size_t shaderCount = 0;
+};
+
+// Keeps the loaders under a memory budget by evicting assets nothing references anymore,
+// acquiring one through its loader again restores it
+class ResourceManager {
+	TextureLoader& textures;
+	SoundLoader& sounds;
+	ShaderLoader& shaders;
+public:
+	MemoryBudget budget;
+
+	ResourceManager(TextureLoader& textureLoader, SoundLoader& soundLoader, ShaderLoader& shaderLoader, MemoryBudget b = {});
+
+	MemoryReport report() const;
+	// Evicts least recently used unreferenced assets of every type that is over budget
+	MemoryReport collect();
+};
@@ -8,6 +8,7 @@ Shader::Shader(std::string source, unsigned int shaderType) : Source(source), Sh
     glCompileShader(shaderId);
     int success;
     glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
+    compiled = success;
     if (!success) {
         glGetShaderInfoLog(shaderId, OPENGL_ERROR_BUFFER_SIZE, NULL, errorBuffer);
         std::cout << "Shader compilation error: " << errorBuffer << std::endl;
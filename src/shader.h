@@ -1,15 +1,23 @@
 #pragma once
 #include <iostream>
+#include <memory>
+#include <utility>
 #include <glad/glad.h>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #define OPENGL_ERROR_BUFFER_SIZE 255
 
+// Binding points of the std140 uniform blocks programs share, assigned to every program when it links
+namespace UniformBlock {
+    constexpr unsigned int Camera = 0;
+}
+
 struct Shader {
     std::string Source;
     unsigned int shaderId;
     unsigned int ShaderType;
+    bool compiled = false;
     char errorBuffer[OPENGL_ERROR_BUFFER_SIZE] = {};
     Shader(std::string source, unsigned int shaderType);
     ~Shader();
@@ -19,6 +27,7 @@ struct ShaderProgram {
     std::unique_ptr<Shader> VertexShader;
     std::unique_ptr<Shader> FragmentShader;
     unsigned int programId = 0;
+    bool linked = false;
     char errorBuffer[OPENGL_ERROR_BUFFER_SIZE] = {};
     ShaderProgram(std::unique_ptr<Shader> vertexShader, std::unique_ptr<Shader> fragmentShader) : VertexShader(std::move(vertexShader)), FragmentShader(std::move(fragmentShader)) {
         std::cout << "Constructing program" << std::endl;
@@ -28,10 +37,33 @@ struct ShaderProgram {
         glLinkProgram(programId);
         int success;
         glGetProgramiv(programId, GL_LINK_STATUS, &success);
+        linked = success && VertexShader->compiled && FragmentShader->compiled;
         if (!success) {
             glGetProgramInfoLog(programId, OPENGL_ERROR_BUFFER_SIZE, NULL, errorBuffer);
             std::cout << "Program compilation error: " << errorBuffer << std::endl;
         }
+        bindUniformBlock("Camera", UniformBlock::Camera);
+    }
+
+    // GLSL 330 has no binding layout qualifier so blocks are wired up from here
+    void bindUniformBlock(const char* blockName, unsigned int binding) {
+        unsigned int index = glGetUniformBlockIndex(programId, blockName);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(programId, index, binding);
+    }
+
+    // Exchanges the GL program with another one, handles to this program see the new code
+    void swap(ShaderProgram& other) {
+        std::swap(VertexShader, other.VertexShader);
+        std::swap(FragmentShader, other.FragmentShader);
+        std::swap(programId, other.programId);
+        std::swap(linked, other.linked);
+    }
+
+    ShaderProgram* setUniform1i(const char* uniformLoc, int arg1) {
+        int location = glGetUniformLocation(programId, uniformLoc);
+        glUniform1i(location, arg1);
+        return this;
     }
 
     ShaderProgram* setUniform1f(const char* uniformLoc, float arg1) {
@@ -0,0 +1,69 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+
+// Thin wrapper over the widest float vector the build targets so kernels are only written once:
+// AVX when compiled with it, SSE2 on any x86-64, one float at a time elsewhere.
+// Loads and stores are unaligned, std::vector storage needs no special allocator.
+// Comparisons give a Mask, select picks per lane between two values with it.
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE
+#endif
+
+namespace Simd {
+#if defined(SIMD_AVX)
+    using Float = __m256;
+    constexpr std::size_t width = 8;
+    inline Float load(const float* p) { return _mm256_loadu_ps(p); }
+    inline void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+    inline Float splat(float v) { return _mm256_set1_ps(v); }
+    inline Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    inline Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    inline Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    inline Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+    inline Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+    // To the nearest integer, ties to even
+    inline Float round(Float v) { return _mm256_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    using Mask = __m256;
+    inline Mask equal(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    inline Mask greaterEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    inline Float select(Mask m, Float a, Float b) { return _mm256_blendv_ps(b, a, m); }
+#elif defined(SIMD_SSE)
+    using Float = __m128;
+    constexpr std::size_t width = 4;
+    inline Float load(const float* p) { return _mm_loadu_ps(p); }
+    inline void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+    inline Float splat(float v) { return _mm_set1_ps(v); }
+    inline Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    inline Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    inline Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    inline Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+    inline Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+    // To the nearest integer, ties to even, for values that fit an int
+    inline Float round(Float v) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(v)); }
+    using Mask = __m128;
+    inline Mask equal(Float a, Float b) { return _mm_cmpeq_ps(a, b); }
+    inline Mask greaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+    inline Float select(Mask m, Float a, Float b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+#else
+    using Float = float;
+    constexpr std::size_t width = 1;
+    inline Float load(const float* p) { return *p; }
+    inline void store(float* p, Float v) { *p = v; }
+    inline Float splat(float v) { return v; }
+    inline Float add(Float a, Float b) { return a + b; }
+    inline Float sub(Float a, Float b) { return a - b; }
+    inline Float mul(Float a, Float b) { return a * b; }
+    inline Float min(Float a, Float b) { return a < b ? a : b; }
+    inline Float max(Float a, Float b) { return a > b ? a : b; }
+    inline Float round(Float v) { return std::nearbyint(v); }
+    using Mask = bool;
+    inline Mask equal(Float a, Float b) { return a == b; }
+    inline Mask greaterEqual(Float a, Float b) { return a >= b; }
+    inline Float select(Mask m, Float a, Float b) { return m ? a : b; }
+#endif
+}
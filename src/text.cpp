@@ -1,5 +1,6 @@
 #include "text.h"
 #include <stdexcept>
+#include "utils.h"
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -17,12 +18,25 @@ Font::Font(std::filesystem::path p) {
 	}
 }
 
+float Font::getKerningAdvance(uint32_t left, uint32_t right, float scale) {
+	return stbtt_GetCodepointKernAdvance(&info, left, right) * scale;
+}
+
 void Font::GenerateImage(unsigned int pixelSize, std::string text) {
-	BitmapTextRenderer f{ pixelSize, this, text };
-	f.outImage();
+	auto& renderer = getBitmapRenderer(pixelSize);
+	renderer.text = text;
+	renderer.outImage();
+}
+
+BitmapTextRenderer& Font::getBitmapRenderer(unsigned int pixelSize) {
+	// Renderers are kept per size so their metric and glyph bitmap caches outlive a single string
+	auto it = fontMap.find(pixelSize);
+	if (it == fontMap.end())
+		it = fontMap.emplace(pixelSize, BitmapTextRenderer{ pixelSize, this, "" }).first;
+	return it->second;
 }
 
-FontAtlas::FontAtlas(Font* _font, int _size, FontRange f = GetRangeFromAlphabet(std::string("![a-zA-Z]~"))) : font(_font), size(_size), range(f), characterData(f.second - f.first) {}
+FontAtlas::FontAtlas(Font* _font, int _size, FontRange f = GetRangeFromAlphabet(std::string("![a-zA-Z]~"))) : GlyphAtlas(_font, _size), range(f), characterData(f.second - f.first) {}
 
 std::vector<unsigned char> FontAtlas::generateFont(std::filesystem::path p) {
 	auto fontBuffer = FS::readFileAsBytes(p); // Reads the ttf file into a binary buffer
@@ -52,13 +66,12 @@ std::vector<unsigned char> FontAtlas::generateFont(std::filesystem::path p) {
 	throw std::runtime_error("could not create texture");
 }
 
-Texture* FontAtlas::generateTexture(std::filesystem::path p) {
-	texture = new Texture();
+std::shared_ptr<Texture> FontAtlas::generateTexture(std::filesystem::path p) {
+	texture = std::make_shared<Texture>();
 	auto fontBitmap = generateFont(p);
 	texture->width = bitmapWidth;
 	texture->height = bitmapHeight;
-	texture->colorSpace = GL_RED;
-	texture->disableAliasing = true;
+	texture->pixelFormat = PixelFormat::negotiate(1);
 	texture->Init(fontBitmap.data());
 	return texture;
 };
@@ -67,8 +80,10 @@ stbtt_aligned_quad FontAtlas::renderChar(uint64_t c, float* x, float* y) {
 	if (texture == nullptr)
 		throw std::runtime_error("Texture not generated");
 	auto [min, max] = range;
+	stbtt_aligned_quad quad = {};
+	if (c < min || c - min >= characterData.size())
+		return quad;
 	int index = c - min;
-	stbtt_aligned_quad quad;
 	stbtt_GetPackedQuad(characterData.data(), bitmapWidth, bitmapHeight, index, x, y, &quad, true);
 	return quad;
 };
@@ -78,7 +93,8 @@ void FontAtlas::outImage(std::filesystem::path p) {
 	stbi_write_png("out.png", bitmapHeight, bitmapWidth, 1, buffer.data(), bitmapWidth);
 }
 
-BitmapTextRenderer::BitmapTextRenderer(unsigned int _height, Font* _font, std::string _text) : height(_height), text(_text), font(_font) {
+BitmapTextRenderer::BitmapTextRenderer(unsigned int _height, Font* _font, std::string _text, unsigned int _threadCount) :
+	height(_height), text(_text), font(_font), threadCount(_threadCount) {
 	scale = stbtt_ScaleForPixelHeight(&font->info, height);
 	std::cout << "Selected scale = " << scale << std::endl;
 
@@ -88,25 +104,23 @@ BitmapTextRenderer::BitmapTextRenderer(unsigned int _height, Font* _font, std::s
 }
 
 CharacterCoordinates& BitmapTextRenderer::getBB(std::size_t i) {
-	CharacterCoordinates* BoundingBox = nullptr;
 	auto c = text[i];
 	if (auto it = characterCache.find(c); it != characterCache.end()) {
 		return (it->second);
 	}
 	else {
+		// Kerning depends on the neighbouring character so it is filled in per position, not cached
 		CharacterCoordinates BB;
 		getCharSize(i, BB);
-		getKearningSize(i, BB);
-		characterCache.emplace(c, BB);
-		it = characterCache.find(c);
-		return (it->second);
+		BB.kearningOffset = 0;
+		return characterCache.emplace(c, BB).first->second;
 	}
 }
 
 std::size_t BitmapTextRenderer::calculateBitmapWidth() {
 	std::size_t x = 0;
 	for (int i = 0; i < text.length(); i++) {
-		auto BoundingBox = getBB(i);
+		auto& BoundingBox = getBB(i);
 		x += BoundingBox.width + 1;
 	}
 	return x;
@@ -121,37 +135,86 @@ void BitmapTextRenderer::getCharSize(std::size_t i, CharacterCoordinates& BB) {
 }
 
 int BitmapTextRenderer::getKearningSize(std::size_t i, CharacterCoordinates& BB) {
-	int kern = i == text.length() - 1 ? 0 : stbtt_GetCodepointKernAdvance(&font->info, text[i], text[i + 1]);
-	BB.kearningOffset = roundf(kern * scale);
-	return kern;
+	float kern = i == text.length() - 1 ? 0 : font->getKerningAdvance(text[i], text[i + 1], scale);
+	BB.kearningOffset = roundf(kern);
+	return BB.kearningOffset;
+}
+
+void BitmapTextRenderer::rasterizeGlyphs() {
+	std::vector<std::pair<char, GlyphBitmap*>> missing;
+	for (std::size_t i = 0; i < text.length(); i++) {
+		auto c = text[i];
+		if (bitmapCache.find(c) != bitmapCache.end())
+			continue;
+		auto& BB = getBB(i);
+		auto& bitmap = bitmapCache[c];
+		bitmap.width = BB.x2 - BB.x1;
+		bitmap.height = BB.y2 - BB.y1;
+		bitmap.pixels.resize(bitmap.width * bitmap.height);
+		missing.push_back({ c, &bitmap });
+	}
+
+	// Every entry exists up front so workers only write into their own pixel buffers
+	Parallel::forRange(missing.size(), threadCount, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) {
+			auto [c, bitmap] = missing[i];
+			if (bitmap->pixels.empty())
+				continue;
+			stbtt_MakeCodepointBitmap(
+				&font->info,
+				bitmap->pixels.data(),
+				bitmap->width,
+				bitmap->height,
+				bitmap->width,
+				scale,
+				scale,
+				c
+			);
+		}
+	});
 }
 
 std::vector<unsigned char> BitmapTextRenderer::writeToBitmap() {
-	std::vector<unsigned char> imageBuffer(calculateBitmapWidth() * height);
-	auto bufferWidth = (imageBuffer.capacity() / height);
+	int bufferWidth = calculateBitmapWidth();
+	std::vector<unsigned char> imageBuffer(bufferWidth * height);
 	std::cout << "Made bitmap of size " << imageBuffer.capacity() << std::endl;
-	for (int i = 0; i < text.length(); i++) {
-		auto BB = getBB(i);
+	rasterizeGlyphs();
+
+	struct Placement {
+		const GlyphBitmap* bitmap;
+		int x, y;
+	};
+	std::vector<Placement> placements;
+	placements.reserve(text.length());
+	for (std::size_t i = 0; i < text.length(); i++) {
+		auto& BB = getBB(i);
 		/* get bounding box for character (may be offset to account for chars that dip above or below the line */
 		int y = ascent + BB.y1;
-
-		/* render character (stride and offset is important here) */
-		int byteOffset = cursor + roundf(BB.leftBearing * scale) + (y * bufferWidth);
-		auto width = (BB.x2 - BB.x1);
-		stbtt_MakeCodepointBitmap(
-			&font->info,
-			imageBuffer.data() + byteOffset,
-			width,
-			BB.y2 - BB.y1,
-			bufferWidth,
-			scale,
-			scale,
-			text[i]
-		);
-		cursor += BB.width + BB.kearningOffset;
+		int x = cursor + roundf(BB.leftBearing * scale);
+		placements.push_back({ &bitmapCache.at(text[i]), x, y });
+		cursor += BB.width + getKearningSize(i, BB);
 	}
-
 	cursor = 0;
+
+	// Each worker owns a band of rows, so glyphs overlapping across a band edge never race.
+	// Overlapping glyphs keep the strongest coverage instead of whichever was drawn last.
+	Parallel::forRange(height, threadCount, [&](std::size_t rowBegin, std::size_t rowEnd) {
+		for (auto& placement : placements) {
+			auto& bitmap = *placement.bitmap;
+			int first = std::max<int>(placement.y, rowBegin);
+			int last = std::min<int>(placement.y + bitmap.height, rowEnd);
+			int columnBegin = std::max(0, -placement.x);
+			int columnEnd = std::min(bitmap.width, bufferWidth - placement.x);
+			for (int row = first; row < last; row++) {
+				const unsigned char* source = bitmap.pixels.data() + (row - placement.y) * bitmap.width;
+				unsigned char* destination = imageBuffer.data() + row * bufferWidth + placement.x;
+				for (int column = columnBegin; column < columnEnd; column++) {
+					destination[column] = std::max(destination[column], source[column]);
+				}
+			}
+		}
+	});
+
 	return imageBuffer;
 }
 
@@ -161,6 +224,7 @@ void BitmapTextRenderer::outImage() {
 }
 
 std::vector<unsigned char> Font::GenerateBitmap(unsigned int pixelSize, std::string text) {
-	BitmapTextRenderer f{ pixelSize, this, text };
-	return f.writeToBitmap();
+	auto& renderer = getBitmapRenderer(pixelSize);
+	renderer.text = text;
+	return renderer.writeToBitmap();
 }
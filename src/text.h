@@ -4,7 +4,9 @@
 #include <iostream>
 #include <unordered_map>
 #include <algorithm>
+#include <memory>
 #include <stdexcept>
+#include <thread>
 #include "fs.h"
 #include "texture.h"
 
@@ -20,18 +22,27 @@ struct CharacterCoordinates {
 };
 
 
+struct GlyphBitmap {
+	int width = 0, height = 0;
+	std::vector<unsigned char> pixels;
+};
+
 class Font;
 class BitmapTextRenderer {
 	std::size_t bufferSize;
+	void rasterizeGlyphs();
 public:
 	Font* font;
 	unsigned int height;
 	std::unordered_map<char, CharacterCoordinates> characterCache;
+	// Rasterized once per character and blitted for every repeat
+	std::unordered_map<char, GlyphBitmap> bitmapCache;
 	std::string text;
 	float scale;
 	int ascent, descent, lineGap;
 	int cursor = 0;
-	BitmapTextRenderer(unsigned int _height, Font* _font, std::string _text);
+	unsigned int threadCount;
+	BitmapTextRenderer(unsigned int _height, Font* _font, std::string _text, unsigned int _threadCount = std::thread::hardware_concurrency());
 
 	CharacterCoordinates& getBB(std::size_t i);
 
@@ -47,8 +58,28 @@ public:
 };
 
 
+// Anything that can turn a codepoint into a textured quad on a single texture
+class GlyphAtlas {
+public:
+	int size;
+	Font* font;
+	// Bumped whenever previously returned quads may point at stale texture regions
+	uint64_t generation = 0;
+	// Texture holds signed distances instead of coverage
+	bool distanceField = false;
+
+	GlyphAtlas(Font* _font, int _size) : font(_font), size(_size) {}
+	virtual ~GlyphAtlas() = default;
+
+	virtual stbtt_aligned_quad renderChar(uint64_t c, float* x, float* y) = 0;
+	virtual Texture* getTexture() = 0;
+	virtual void nextFrame() {}
+	// Marks a glyph as in use without laying it out again
+	virtual void touch(uint64_t c) {}
+};
+
 using FontRange = std::pair<uint64_t, uint64_t>;
-class FontAtlas {
+class FontAtlas : public GlyphAtlas {
 	FontRange range;
 	int bitmapWidth = 0xFF;
 	int bitmapHeight = 0xFF;
@@ -56,10 +87,8 @@ class FontAtlas {
 	int oversamplingRate = 2;
 	stbtt_pack_context packContext;
 	std::vector<stbtt_packedchar> characterData;
-	Texture* texture = nullptr;
+	std::shared_ptr<Texture> texture;
 public:
-	int size;
-	Font* font;
 	static FontRange GetRangeFromAlphabet(std::string const& alphabet) {
 		uint64_t min = 0xFFFFFFFF;
 		uint64_t max = 0;
@@ -74,9 +103,11 @@ public:
 
 	std::vector<unsigned char> generateFont(std::filesystem::path p);
 
-	Texture* generateTexture(std::filesystem::path p);
+	std::shared_ptr<Texture> generateTexture(std::filesystem::path p);
 
-	stbtt_aligned_quad renderChar(uint64_t c, float* x, float* y);
+	stbtt_aligned_quad renderChar(uint64_t c, float* x, float* y) override;
+
+	Texture* getTexture() override { return texture.get(); }
 
 	void outImage(std::filesystem::path p);
 };
@@ -89,6 +120,9 @@ public:
 	std::vector<char> buffer;
 	Font(std::filesystem::path p);
 
+	float getKerningAdvance(uint32_t left, uint32_t right, float scale);
+
+	BitmapTextRenderer& getBitmapRenderer(unsigned int pixelSize);
 	void GenerateImage(unsigned int pixelSize, std::string text);
 	std::vector<unsigned char> GenerateBitmap(unsigned int pixelSize, std::string text);
 };
\ No newline at end of file
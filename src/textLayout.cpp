@@ -0,0 +1,170 @@
+#include "textLayout.h"
+#include <algorithm>
+#include <functional>
+
+#include "utils.h"
+
+namespace {
+	struct ShapedGlyph {
+		uint32_t codepoint;
+		// Quad relative to a pen at the origin
+		stbtt_aligned_quad quad;
+		float advance;
+		// Kerning against the previous glyph on the same paragraph
+		float kerning;
+	};
+
+	bool isBreakable(uint32_t codepoint) {
+		return codepoint == ' ' || codepoint == '\t';
+	}
+
+	// Greedy word wrap, returns [start, end) ranges into the paragraph
+	std::vector<std::pair<std::size_t, std::size_t>> breakLines(const std::vector<ShapedGlyph>& glyphs, float maxWidth) {
+		std::vector<std::pair<std::size_t, std::size_t>> lines;
+		std::size_t lineStart = 0;
+		std::size_t lastBreak = SIZE_MAX;
+		float x = 0;
+		for (std::size_t i = 0; i < glyphs.size(); i++) {
+			auto& glyph = glyphs[i];
+			float penX = i == lineStart ? 0 : x + glyph.kerning;
+			bool overflows = maxWidth > 0 && i > lineStart && !isBreakable(glyph.codepoint) && penX + glyph.quad.x1 > maxWidth;
+			if (overflows) {
+				std::size_t next;
+				if (lastBreak != SIZE_MAX && lastBreak >= lineStart) {
+					// Drop the whitespace the line was broken on
+					lines.push_back({ lineStart, lastBreak });
+					next = lastBreak + 1;
+				}
+				else {
+					// A single word wider than the line gets split wherever it overflows
+					lines.push_back({ lineStart, i });
+					next = i;
+				}
+				lineStart = next;
+				lastBreak = SIZE_MAX;
+				x = 0;
+				for (std::size_t j = lineStart; j < i; j++) {
+					x += (j == lineStart ? 0 : glyphs[j].kerning) + glyphs[j].advance;
+				}
+				penX = i == lineStart ? 0 : x + glyph.kerning;
+			}
+			if (isBreakable(glyph.codepoint))
+				lastBreak = i;
+			x = penX + glyph.advance;
+		}
+		lines.push_back({ lineStart, glyphs.size() });
+		return lines;
+	}
+}
+
+GlyphRun TextLayout::layout(GlyphAtlas& atlas, const std::string& text, const LayoutOptions& options) {
+	GlyphRun run;
+	auto codepoints = Unicode::decodeUtf8(text);
+	run.glyphs.reserve(codepoints.size());
+
+	float scale = stbtt_ScaleForPixelHeight(&atlas.font->info, atlas.size);
+	int ascent, descent, lineGap;
+	stbtt_GetFontVMetrics(&atlas.font->info, &ascent, &descent, &lineGap);
+	float lineHeight = (ascent - descent + lineGap) * scale * options.lineSpacing;
+
+	// Split into paragraphs on hard breaks, then wrap each paragraph
+	struct Line {
+		std::vector<PositionedGlyph> glyphs;
+		float width;
+	};
+	std::vector<Line> lines;
+	std::vector<ShapedGlyph> paragraph;
+	auto flushParagraph = [&]() {
+		for (auto [start, end] : breakLines(paragraph, options.maxWidth)) {
+			Line line{ {}, 0.0f };
+			float x = 0;
+			for (std::size_t i = start; i < end; i++) {
+				auto& glyph = paragraph[i];
+				if (i != start)
+					x += glyph.kerning;
+				auto quad = glyph.quad;
+				quad.x0 += x;
+				quad.x1 += x;
+				line.glyphs.push_back({ glyph.codepoint, quad });
+				x += glyph.advance;
+				line.width = std::max(line.width, quad.x1);
+			}
+			lines.push_back(std::move(line));
+		}
+		paragraph.clear();
+	};
+
+	uint32_t previous = 0;
+	for (auto codepoint : codepoints) {
+		if (codepoint == '\r')
+			continue;
+		if (codepoint == '\n') {
+			flushParagraph();
+			previous = 0;
+			continue;
+		}
+		float x = 0, y = 0;
+		auto quad = atlas.renderChar(codepoint, &x, &y);
+		float kerning = previous == 0 ? 0 : atlas.font->getKerningAdvance(previous, codepoint, scale);
+		paragraph.push_back({ codepoint, quad, x, kerning });
+		previous = codepoint;
+	}
+	flushParagraph();
+
+	for (auto& line : lines) {
+		run.width = std::max(run.width, line.width);
+	}
+	float alignWidth = options.maxWidth > 0 ? options.maxWidth : run.width;
+	float y = 0;
+	for (auto& line : lines) {
+		float offset = 0;
+		if (options.align == TextAlign::Center)
+			offset = (alignWidth - line.width) * 0.5f;
+		else if (options.align == TextAlign::Right)
+			offset = alignWidth - line.width;
+		for (auto& glyph : line.glyphs) {
+			glyph.quad.x0 += offset;
+			glyph.quad.x1 += offset;
+			glyph.quad.y0 += y;
+			glyph.quad.y1 += y;
+			run.glyphs.push_back(glyph);
+		}
+		y += lineHeight;
+	}
+	run.lineCount = lines.size();
+	run.height = lines.size() * lineHeight;
+	// Evictions while rasterizing only hit glyphs from earlier frames, so these quads are current
+	run.generation = atlas.generation;
+	return run;
+}
+
+std::size_t TextLayoutCache::KeyHash::operator()(const Key& key) const {
+	std::size_t hash = std::hash<std::string>()(key.text);
+	auto combine = [&hash](std::size_t value) {
+		hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	};
+	combine(std::hash<const void*>()(key.atlas));
+	combine(std::hash<int>()(key.size));
+	combine(std::hash<float>()(key.options.maxWidth));
+	combine(std::hash<int>()((int)key.options.align));
+	combine(std::hash<float>()(key.options.lineSpacing));
+	return hash;
+}
+
+std::shared_ptr<const GlyphRun> TextLayoutCache::get(GlyphAtlas& atlas, const std::string& text, const LayoutOptions& options) {
+	Key key{ &atlas, atlas.size, text, options };
+	if (auto it = runs.find(key); it != runs.end() && it->second->generation == atlas.generation) {
+		hits++;
+		// Keep the glyphs resident even though they were not re-rasterized
+		for (auto& glyph : it->second->glyphs) {
+			atlas.touch(glyph.codepoint);
+		}
+		return it->second;
+	}
+	misses++;
+	if (runs.size() >= capacity)
+		runs.clear();
+	auto run = std::make_shared<GlyphRun>(TextLayout::layout(atlas, text, options));
+	runs[key] = run;
+	return run;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "text.h"
+
+enum class TextAlign {
+	Left,
+	Center,
+	Right
+};
+
+struct LayoutOptions {
+	// Wrap lines wider than this many pixels at the atlas size, 0 disables wrapping
+	float maxWidth = 0.0f;
+	TextAlign align = TextAlign::Left;
+	float lineSpacing = 1.0f;
+
+	bool operator==(const LayoutOptions& other) const {
+		return maxWidth == other.maxWidth && align == other.align && lineSpacing == other.lineSpacing;
+	}
+};
+
+struct PositionedGlyph {
+	uint32_t codepoint;
+	// Pixel coordinates at the atlas size, y grows downwards from the first baseline
+	stbtt_aligned_quad quad;
+};
+
+struct GlyphRun {
+	std::vector<PositionedGlyph> glyphs;
+	float width = 0.0f;
+	float height = 0.0f;
+	int lineCount = 0;
+	// Atlas generation the quads were produced against
+	uint64_t generation = 0;
+};
+
+namespace TextLayout {
+	GlyphRun layout(GlyphAtlas& atlas, const std::string& text, const LayoutOptions& options = {});
+}
+
+// Remembers glyph runs per (atlas, size, string, options) so unchanged labels skip layout entirely
+class TextLayoutCache {
+	struct Key {
+		const GlyphAtlas* atlas;
+		int size;
+		std::string text;
+		LayoutOptions options;
+
+		bool operator==(const Key& other) const {
+			return atlas == other.atlas && size == other.size && text == other.text && options == other.options;
+		}
+	};
+	struct KeyHash {
+		std::size_t operator()(const Key& key) const;
+	};
+	std::unordered_map<Key, std::shared_ptr<GlyphRun>, KeyHash> runs;
+public:
+	// Once this many runs are cached the cache starts over rather than tracking recency
+	std::size_t capacity = 1024;
+	std::size_t hits = 0;
+	std::size_t misses = 0;
+
+	std::shared_ptr<const GlyphRun> get(GlyphAtlas& atlas, const std::string& text, const LayoutOptions& options = {});
+	void clear() { runs.clear(); }
+	std::size_t size() const { return runs.size(); }
+};
@@ -1,27 +1,303 @@
 #include "texture.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 
 
-void Texture::Init(unsigned char* data) {
+namespace {
+    // Largest alignment GL_UNPACK_ALIGNMENT accepts that tightly packed rows satisfy
+    int unpackAlignment(int rowBytes) {
+        for (int alignment : { 8, 4, 2 }) {
+            if (rowBytes % alignment == 0)
+                return alignment;
+        }
+        return 1;
+    }
+
+    int mipLevels(int width, int height) {
+        int levels = 1;
+        for (int size = std::max(width, height); size > 1; size /= 2) {
+            levels++;
+        }
+        return levels;
+    }
+}
+
+PixelFormat PixelFormat::negotiate(int channels, PixelDepth depth, bool srgb) {
+    static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    static const GLenum unorm8[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+    static const GLenum unorm16[] = { GL_R16, GL_RG16, GL_RGB16, GL_RGBA16 };
+    static const GLenum half[] = { GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F };
+    int index = std::clamp(channels, 1, 4) - 1;
+    // Drivers pad three channel formats out to four
+    int storedChannels = index == 2 ? 4 : index + 1;
+
+    PixelFormat pixelFormat;
+    pixelFormat.format = formats[index];
+    switch (depth) {
+    case PixelDepth::UInt8:
+        pixelFormat.internalFormat = unorm8[index];
+        if (srgb && index == 2)
+            pixelFormat.internalFormat = GL_SRGB8;
+        if (srgb && index == 3)
+            pixelFormat.internalFormat = GL_SRGB8_ALPHA8;
+        pixelFormat.type = GL_UNSIGNED_BYTE;
+        pixelFormat.clientBytes = index + 1;
+        pixelFormat.storageBytes = storedChannels;
+        break;
+    case PixelDepth::UInt16:
+        pixelFormat.internalFormat = unorm16[index];
+        pixelFormat.type = GL_UNSIGNED_SHORT;
+        pixelFormat.clientBytes = (index + 1) * 2;
+        pixelFormat.storageBytes = storedChannels * 2;
+        break;
+    case PixelDepth::Float32:
+        pixelFormat.internalFormat = half[index];
+        pixelFormat.type = GL_FLOAT;
+        pixelFormat.clientBytes = (index + 1) * 4;
+        pixelFormat.storageBytes = storedChannels * 2;
+        break;
+    }
+    return pixelFormat;
+}
+
+void Texture::Init(const void* data) {
+    version++;
     glGenTextures(1, &textureId);
     glBindTexture(GL_TEXTURE_2D, textureId);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, disableAliasing ? 1 : 4);
-    glTexImage2D(GL_TEXTURE_2D, 0, colorSpace, width, height, 0, colorSpace, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(width * pixelFormat.clientBytes));
+    int levels = generateMipmaps ? mipLevels(width, height) : 1;
+    // Immutable storage is validated once instead of on every use; window setup only loads the
+    // entry point when the driver supports it
+    if (glTexStorage2D) {
+        glTexStorage2D(GL_TEXTURE_2D, levels, pixelFormat.internalFormat, width, height);
+        if (data)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, pixelFormat.format, pixelFormat.type, data);
+    }
+    else {
+        glTexImage2D(GL_TEXTURE_2D, 0, pixelFormat.internalFormat, width, height, 0, pixelFormat.format, pixelFormat.type, data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
+    if (generateMipmaps)
+        glGenerateMipmap(GL_TEXTURE_2D);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generateMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
+void Texture::update(int x, int y, int w, int h, const void* data, bool refreshMipmaps) {
+    version++;
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(w * pixelFormat.clientBytes));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, pixelFormat.format, pixelFormat.type, data);
+    if (generateMipmaps && refreshMipmaps)
+        glGenerateMipmap(GL_TEXTURE_2D);
+}
+
 void Texture::setActive() {
     glActiveTexture(textureId);
 }
 
-Texture::~Texture() {;
+void Texture::swap(Texture& other) {
+    std::swap(textureId, other.textureId);
+    std::swap(width, other.width);
+    std::swap(height, other.height);
+    std::swap(pixelFormat, other.pixelFormat);
+    std::swap(alphaMode, other.alphaMode);
+    std::swap(hull, other.hull);
+    version++;
+    other.version++;
+}
+
+void Texture::unload() {
     glDeleteTextures(1, &textureId);
+    textureId = 0;
+    version++;
+}
+
+std::size_t Texture::gpuBytes() const {
+    if (textureId == 0)
+        return 0;
+    std::size_t bytes = std::size_t(width) * height * pixelFormat.storageBytes;
+    // A full mip chain adds a third on top of the base level
+    return generateMipmaps ? bytes + bytes / 3 : bytes;
+}
+
+std::array<glm::vec2, Texture::hullVertexCount> Texture::hullCorners() const {
+    static const std::vector<glm::vec2> quad = { { 1.0f, 1.0f }, { 1.0f, 0.0f }, { 0.0f, 0.0f }, { 0.0f, 1.0f } };
+    auto& corners = hull.empty() ? quad : hull;
+    std::array<glm::vec2, hullVertexCount> padded;
+    for (int i = 0; i < hullVertexCount; i++) {
+        padded[i] = corners[std::min<std::size_t>(i, corners.size() - 1)];
+    }
+    return padded;
+}
+
+void ImageData::Deleter::operator()(unsigned char* data) const {
+    stbi_image_free(data);
+}
+
+namespace {
+    template <typename Channel>
+    AlphaMode scanAlpha(const Channel* pixels, std::size_t pixelCount, int channels, Channel full) {
+        // Grey and alpha images keep alpha second, RGBA fourth
+        int alpha = channels - 1;
+        bool partial = false;
+        for (std::size_t i = 0; i < pixelCount; i++) {
+            Channel value = pixels[i * channels + alpha];
+            if (value == full)
+                continue;
+            if (value != Channel(0))
+                return AlphaMode::Translucent;
+            partial = true;
+        }
+        return partial ? AlphaMode::Masked : AlphaMode::Opaque;
+    }
+}
+
+namespace {
+    float cross(glm::vec2 a, glm::vec2 b) {
+        return a.x * b.y - a.y * b.x;
+    }
+
+    // Andrew's monotone chain, counter clockwise without collinear points
+    std::vector<glm::vec2> convexHull(std::vector<glm::vec2> points) {
+        std::sort(points.begin(), points.end(), [](glm::vec2 a, glm::vec2 b) {
+            return a.x != b.x ? a.x < b.x : a.y < b.y;
+        });
+        if (points.size() < 3)
+            return points;
+        std::vector<glm::vec2> hull(points.size() * 2);
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < points.size(); i++) {
+            while (count >= 2 && cross(hull[count - 1] - hull[count - 2], points[i] - hull[count - 2]) <= 0.0f)
+                count--;
+            hull[count++] = points[i];
+        }
+        for (std::size_t i = points.size() - 1, lower = count + 1; i > 0; i--) {
+            while (count >= lower && cross(hull[count - 1] - hull[count - 2], points[i - 1] - hull[count - 2]) <= 0.0f)
+                count--;
+            hull[count++] = points[i - 1];
+        }
+        hull.resize(count - 1);
+        return hull;
+    }
+
+    // Removes edges of a counter clockwise hull until it has maxVertices corners. Each step drops the edge
+    // whose neighbours, extended until they meet, add the least area, so the result still covers the hull.
+    // Returns false when no edge can go without leaving the bounds.
+    bool reduceHull(std::vector<glm::vec2>& hull, std::size_t maxVertices, glm::vec2 bounds) {
+        while (hull.size() > maxVertices) {
+            std::size_t n = hull.size();
+            std::size_t best = n;
+            float bestArea = INFINITY;
+            glm::vec2 bestCorner;
+            for (std::size_t i = 0; i < n; i++) {
+                glm::vec2 a = hull[(i + n - 1) % n], b = hull[i], c = hull[(i + 1) % n], d = hull[(i + 2) % n];
+                glm::vec2 before = b - a, after = c - d, edge = c - b;
+                float denominator = cross(before, after);
+                if (std::abs(denominator) < 1e-6f)
+                    continue;
+                float t = cross(edge, after) / denominator;
+                float s = cross(edge, before) / denominator;
+                if (t <= 0.0f || s <= 0.0f)
+                    continue;
+                glm::vec2 corner = b + before * t;
+                if (corner.x < 0.0f || corner.y < 0.0f || corner.x > bounds.x || corner.y > bounds.y)
+                    continue;
+                float area = 0.5f * std::abs(cross(corner - b, edge));
+                if (area < bestArea) {
+                    bestArea = area;
+                    best = i;
+                    bestCorner = corner;
+                }
+            }
+            if (best == n)
+                return false;
+            hull[best] = bestCorner;
+            hull.erase(hull.begin() + (best + 1) % n);
+        }
+        return true;
+    }
+
+    template <typename Channel>
+    std::vector<glm::vec2> alphaHull(const Channel* pixels, int width, int height, int channels, std::size_t maxVertices) {
+        int alpha = channels - 1;
+        // Pixel corners of the covered span of each row, grown by a pixel for filtering
+        std::vector<glm::vec2> points;
+        for (int y = 0; y < height; y++) {
+            const Channel* row = pixels + std::size_t(y) * width * channels;
+            int first = -1, last = -1;
+            for (int x = 0; x < width; x++) {
+                if (row[x * channels + alpha] == Channel(0))
+                    continue;
+                if (first < 0)
+                    first = x;
+                last = x;
+            }
+            if (first < 0)
+                continue;
+            float x0 = float(std::max(0, first - 1)), x1 = float(std::min(width, last + 2));
+            float y0 = float(std::max(0, y - 1)), y1 = float(std::min(height, y + 2));
+            points.insert(points.end(), { { x0, y0 }, { x1, y0 }, { x0, y1 }, { x1, y1 } });
+        }
+        // Nothing visible, one corner makes every triangle of the fan degenerate
+        if (points.empty())
+            return { glm::vec2(0.0f) };
+
+        glm::vec2 size = glm::vec2(width, height);
+        auto hull = convexHull(points);
+        if (!reduceHull(hull, maxVertices, size)) {
+            glm::vec2 low = hull[0], high = hull[0];
+            for (auto& point : hull) {
+                low = glm::vec2(std::min(low.x, point.x), std::min(low.y, point.y));
+                high = glm::vec2(std::max(high.x, point.x), std::max(high.y, point.y));
+            }
+            hull = { low, { high.x, low.y }, high, { low.x, high.y } };
+        }
+        // To uv space, reversed to wind the same way as the sprite quad
+        std::vector<glm::vec2> uvs;
+        for (auto it = hull.rbegin(); it != hull.rend(); ++it) {
+            uvs.push_back(glm::vec2(it->x / size.x, it->y / size.y));
+        }
+        return uvs;
+    }
+}
+
+std::vector<glm::vec2> ImageData::computeHull(int maxVertices) const {
+    if (!pixels || (channels != 2 && channels != 4))
+        return {};
+    switch (depth) {
+    case PixelDepth::UInt16:
+        return alphaHull(reinterpret_cast<const std::uint16_t*>(pixels.get()), width, height, channels, maxVertices);
+    case PixelDepth::Float32:
+        return alphaHull(reinterpret_cast<const float*>(pixels.get()), width, height, channels, maxVertices);
+    default:
+        return alphaHull(pixels.get(), width, height, channels, maxVertices);
+    }
+}
+
+AlphaMode ImageData::classifyAlpha() const {
+    if (!pixels || (channels != 2 && channels != 4))
+        return AlphaMode::Opaque;
+    std::size_t pixelCount = std::size_t(width) * height;
+    switch (depth) {
+    case PixelDepth::UInt16:
+        return scanAlpha(reinterpret_cast<const std::uint16_t*>(pixels.get()), pixelCount, channels, std::uint16_t(0xFFFF));
+    case PixelDepth::Float32:
+        return scanAlpha(reinterpret_cast<const float*>(pixels.get()), pixelCount, channels, 1.0f);
+    default:
+        return scanAlpha(pixels.get(), pixelCount, channels, (unsigned char)0xFF);
+    }
+}
+
+Texture::~Texture() {
+    if (textureId != 0)
+        glDeleteTextures(1, &textureId);
 }
 
 ImageTexture::ImageTexture(const std::filesystem::path& p) : path(p.string()) {}
@@ -30,16 +306,241 @@ ImageTexture::~ImageTexture() {
     std::cout << "Deleting texture " << path << std::endl;
 }
 
-void ImageTexture::Init() {
+ImageData ImageTexture::Decode(const std::filesystem::path& p, PixelDepth maxDepth) {
+    ImageData image;
+    auto pathStr = p.string();
     stbi_set_flip_vertically_on_load(true);
-    const char* pathStr = path.c_str();
     std::cout << "Loading image " << pathStr << std::endl;
-    unsigned char* data = stbi_load(pathStr, &width, &height, &channels, 0);
-    std::cout << "Texture" << width << " x " << height << "(" << &data << ")" << std::endl;
-    if (!data) {
+    unsigned char* pixels;
+    if (maxDepth == PixelDepth::Float32 && stbi_is_hdr(pathStr.c_str())) {
+        image.depth = PixelDepth::Float32;
+        pixels = reinterpret_cast<unsigned char*>(stbi_loadf(pathStr.c_str(), &image.width, &image.height, &image.channels, 0));
+    }
+    else if (maxDepth != PixelDepth::UInt8 && stbi_is_16_bit(pathStr.c_str())) {
+        image.depth = PixelDepth::UInt16;
+        pixels = reinterpret_cast<unsigned char*>(stbi_load_16(pathStr.c_str(), &image.width, &image.height, &image.channels, 0));
+    }
+    else {
+        pixels = stbi_load(pathStr.c_str(), &image.width, &image.height, &image.channels, 0);
+    }
+    image.pixels.reset(pixels);
+    if (!image.pixels) {
         std::cout << "failed to load image " << pathStr << std::endl;
+    }
+    image.alphaMode = image.classifyAlpha();
+    if (image.alphaMode != AlphaMode::Opaque)
+        image.hull = image.computeHull(Texture::hullVertexCount);
+    return image;
+}
+
+void ImageTexture::Init() {
+    Init(Decode(path, maxDepth));
+}
+
+void ImageTexture::Init(const ImageData& image) {
+    if (!image.pixels)
+        return;
+    describe(image);
+    Texture::Init(image.pixels.get());
+}
+
+void ImageTexture::Allocate(const ImageData& image) {
+    if (!image.pixels)
+        return;
+    describe(image);
+    Texture::Init(nullptr);
+}
+
+void ImageTexture::describe(const ImageData& image) {
+    width = image.width;
+    height = image.height;
+    channels = image.channels;
+    alphaMode = image.alphaMode;
+    hull = image.hull;
+    pixelFormat = PixelFormat::negotiate(channels, image.depth, srgb);
+    std::cout << "Texture" << width << " x " << height << std::endl;
+}
+
+CompressedTexture::CompressedTexture(const std::filesystem::path& p) : ImageTexture(p) {}
+
+bool CompressedTexture::formatSupported(TextureCompression::Format format) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    std::vector<GLint> formats(count);
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+    return std::find(formats.begin(), formats.end(), (GLint)TextureCompression::glInternalFormat(format)) != formats.end();
+}
+
+void CompressedTexture::Init() {
+    TextureCompression::CompressedImage image;
+    try {
+        std::cout << "Loading compressed image " << path << std::endl;
+        image = TextureCompression::readKtx(path);
+    }
+    catch (const std::runtime_error& e) {
+        std::cout << "failed to load image " << e.what() << std::endl;
         return;
     }
-    Texture::Init(data);
-    stbi_image_free(data);
-}
\ No newline at end of file
+    width = image.levels[0].width;
+    height = image.levels[0].height;
+    bool alpha = image.format == TextureCompression::Format::BC3;
+    channels = alpha ? 4 : 3;
+    // Only the uncompressed source knew which BC3 pixels are see through
+    alphaMode = alpha ? AlphaMode::Translucent : AlphaMode::Opaque;
+    pixelFormat = PixelFormat::negotiate(channels);
+    bool native = formatSupported(image.format);
+    if (!native)
+        std::cout << "S3TC unsupported, decoding " << path << " on the CPU" << std::endl;
+
+    version++;
+    glGenTextures(1, &textureId);
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    compressedBytes = 0;
+    for (std::size_t level = 0; level < image.levels.size(); level++) {
+        auto& mip = image.levels[level];
+        if (native) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, TextureCompression::glInternalFormat(image.format),
+                mip.width, mip.height, 0, mip.data.size(), mip.data.data());
+            compressedBytes += mip.data.size();
+        }
+        else {
+            auto rgba = TextureCompression::decode(mip, image.format);
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+            compressedBytes += rgba.size();
+        }
+    }
+    bool mipmapped = image.levels.size() > 1;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+std::size_t CompressedTexture::gpuBytes() const {
+    return textureId == 0 ? 0 : compressedBytes;
+}
+
+TextureArray::TextureArray(int w, int h, int count) : width(w), height(h), layerCount(count) {
+    int levels = mipLevels(width, height);
+    glGenTextures(1, &textureId);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenFramebuffers(1, &readFramebuffer);
+    glGenFramebuffers(1, &drawFramebuffer);
+
+    glGenBuffers(1, &hullBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, hullBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec2) * Texture::hullVertexCount * layerCount, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glGenTextures(1, &hullTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, hullTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, hullBuffer);
+}
+
+TextureArray::~TextureArray() {
+    glDeleteFramebuffers(1, &readFramebuffer);
+    glDeleteFramebuffers(1, &drawFramebuffer);
+    glDeleteTextures(1, &hullTexture);
+    glDeleteBuffers(1, &hullBuffer);
+    glDeleteTextures(1, &decodedTexture);
+    glDeleteTextures(1, &textureId);
+}
+
+int TextureArray::add(std::shared_ptr<Texture> texture) {
+    int existing = layerOf(texture.get());
+    if (existing >= 0)
+        return existing;
+    if ((int)layers.size() == layerCount) {
+        std::cout << "Texture array is full, " << layerCount << " layers" << std::endl;
+        return -1;
+    }
+    int layer = layers.size();
+    layerIndex[texture.get()] = layer;
+    layers.push_back({ std::move(texture) });
+    refresh();
+    return layer;
+}
+
+int TextureArray::layerOf(const Texture* texture) const {
+    auto it = layerIndex.find(texture);
+    return it == layerIndex.end() ? -1 : it->second;
+}
+
+void TextureArray::refresh() {
+    bool copied = false;
+    for (int layer = 0; layer < (int)layers.size(); layer++) {
+        auto& source = *layers[layer].source;
+        if (source.textureId == 0 || source.version == layers[layer].version)
+            continue;
+        layers[layer].version = source.version;
+        copied = copy(layer) || copied;
+        // A reload can bring a different outline along with the pixels
+        auto corners = source.hullCorners();
+        glBindBuffer(GL_TEXTURE_BUFFER, hullBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, sizeof(corners) * layer, sizeof(corners), corners.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+    if (copied) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    }
+}
+
+bool TextureArray::copy(int layer) {
+    auto& source = *layers[layer].source;
+    GLint previousRead, previousDraw;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDraw);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source.textureId, 0);
+    // Compressed sources can't be attached to a framebuffer, blit from a decoded copy instead
+    if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        decode(source);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, decodedTexture, 0);
+    }
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureId, 0, layer);
+    bool complete = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE
+        && glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete)
+        glBlitFramebuffer(0, 0, source.width, source.height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    else
+        std::cout << "Could not copy texture into array layer " << layer << std::endl;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousRead);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDraw);
+    return complete;
+}
+
+void TextureArray::decode(const Texture& source) {
+    // The driver decompresses on read back, only paid when the source changes
+    std::vector<unsigned char> pixels(std::size_t(source.width) * source.height * 4);
+    glBindTexture(GL_TEXTURE_2D, source.textureId);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    if (decodedTexture == 0) {
+        glGenTextures(1, &decodedTexture);
+        glBindTexture(GL_TEXTURE_2D, decodedTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, decodedTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, source.width, source.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+void TextureArray::bind(int unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+}
+
+void TextureArray::bindHulls(int unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, hullTexture);
+}
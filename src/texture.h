@@ -1,26 +1,161 @@
 #pragma once
 #include <glad/glad.h>
+#include <array>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/vec2.hpp>
+#include "textureCompression.h"
+
+// Per channel precision of pixels handed to GL
+enum class PixelDepth {
+    UInt8,
+    UInt16,
+    // HDR images, stored as half floats on the GPU
+    Float32
+};
+
+// How a texture's alpha has to be drawn, found by scanning its pixels when decoded
+enum class AlphaMode {
+    // Every pixel fully covers what's behind it, can be drawn without blending
+    Opaque,
+    // Alpha is only ever fully on or fully off
+    Masked,
+    Translucent
+};
+
+// How pixels are laid out in client memory and the sized format the driver keeps them in
+struct PixelFormat {
+    GLenum internalFormat = GL_RGB8;
+    GLenum format = GL_RGB;
+    GLenum type = GL_UNSIGNED_BYTE;
+    // Bytes per pixel in the uploaded data and, estimated, in video memory
+    int clientBytes = 3;
+    int storageBytes = 4;
+
+    // srgb only applies to 8 bit colour images, single and dual channel data is always linear
+    static PixelFormat negotiate(int channels, PixelDepth depth = PixelDepth::UInt8, bool srgb = false);
+};
 
 struct Texture {
     int width;
     int height;
-    unsigned int textureId;
-    int colorSpace = GL_RGB;
-    bool disableAliasing = false;
+    unsigned int textureId = 0;
+    // Bumped whenever the pixels change so copies of the texture know to refresh
+    uint64_t version = 0;
+    PixelFormat pixelFormat;
+    // Unknown contents, like render targets, are assumed translucent
+    AlphaMode alphaMode = AlphaMode::Translucent;
+    // Corners a sprite of this texture is drawn with instead of a full quad
+    static constexpr int hullVertexCount = 8;
+    // Convex polygon in uv space covering every pixel with any alpha, wound clockwise like the sprite
+    // quad. Empty covers the whole quad.
+    std::vector<glm::vec2> hull;
+    bool generateMipmaps = true;
 
-    void Init(unsigned char* data);
+    // Allocates immutable storage when the driver has glTexStorage2D, data may be null
+    void Init(const void* data);
+    // Uploads a sub-rectangle of pixels in the texture's pixel format. With a pixel unpack buffer
+    // bound data is an offset into it. Batched partial uploads can leave the mips for the last one.
+    void update(int x, int y, int w, int h, const void* data, bool refreshMipmaps = true);
     void setActive();
+    // Exchanges the GL texture with another one, handles to this texture see the new image
+    void swap(Texture& other);
+    // Releases the GL texture, Init brings it back
+    void unload();
+    // Estimated video memory held by the texture including its mip chain
+    virtual std::size_t gpuBytes() const;
+    // The hull padded to hullVertexCount corners by repeating its last one, drawable as a triangle fan
+    std::array<glm::vec2, hullVertexCount> hullCorners() const;
+
+    virtual ~Texture();
+};
 
-    ~Texture();
+// Pixels decoded on the CPU, safe to produce off the GL thread
+struct ImageData {
+    struct Deleter {
+        void operator()(unsigned char* data) const;
+    };
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    PixelDepth depth = PixelDepth::UInt8;
+    AlphaMode alphaMode = AlphaMode::Opaque;
+    // See Texture::hull
+    std::vector<glm::vec2> hull;
+    std::unique_ptr<unsigned char, Deleter> pixels;
+
+    // Scans the alpha channel, images without one are opaque
+    AlphaMode classifyAlpha() const;
+    // Convex polygon of at most maxVertices corners around every pixel with any alpha. A pixel of
+    // margin is kept for filtering, corners stay inside the image.
+    std::vector<glm::vec2> computeHull(int maxVertices) const;
 };
 
 struct ImageTexture : public Texture {
     int channels;
     std::string path;
+    // Images with more precision than maxDepth are converted down while decoding
+    PixelDepth maxDepth = PixelDepth::UInt8;
+    bool srgb = false;
     ImageTexture(const std::filesystem::path& path);
-    void Init();
+    static ImageData Decode(const std::filesystem::path& path, PixelDepth maxDepth = PixelDepth::UInt8);
+    virtual void Init();
+    void Init(const ImageData& image);
+    // Sizes the texture for image without uploading any pixels, for streamed uploads
+    void Allocate(const ImageData& image);
     ~ImageTexture();
+private:
+    void describe(const ImageData& image);
+};
+
+// Block compressed texture read from a .ktx file made by the textureCompressor tool.
+// Mips come from the file, drivers without S3TC get the levels decoded back to RGBA on the CPU.
+struct CompressedTexture : public ImageTexture {
+    std::size_t compressedBytes = 0;
+    CompressedTexture(const std::filesystem::path& path);
+    static bool formatSupported(TextureCompression::Format format);
+    void Init() override;
+    std::size_t gpuBytes() const override;
 };
 
+
+// Same sized RGBA layers sampled as one GL_TEXTURE_2D_ARRAY so sprites using different images can
+// share a draw. Layers are copied from regular textures on the GPU and scaled to the array size.
+// Each layer's hull corners are kept in an RG32F texture buffer, Texture::hullVertexCount per layer.
+struct TextureArray {
+    int width;
+    int height;
+    int layerCount;
+    unsigned int textureId = 0;
+    unsigned int hullBuffer = 0;
+    unsigned int hullTexture = 0;
+
+    TextureArray(int width, int height, int layerCount);
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+    ~TextureArray();
+
+    // Returns the layer holding texture, -1 once the array is full
+    int add(std::shared_ptr<Texture> texture);
+    int layerOf(const Texture* texture) const;
+    // Copies layers again whose source was updated, reloaded or restored since the last copy
+    void refresh();
+    void bind(int unit = 0);
+    void bindHulls(int unit);
+private:
+    struct Layer {
+        std::shared_ptr<Texture> source;
+        uint64_t version = UINT64_MAX;
+    };
+    std::vector<Layer> layers;
+    std::unordered_map<const Texture*, int> layerIndex;
+    unsigned int readFramebuffer = 0;
+    unsigned int drawFramebuffer = 0;
+    // Uncompressed stand in for sources a framebuffer can't read, like compressed textures
+    unsigned int decodedTexture = 0;
+    bool copy(int layer);
+    void decode(const Texture& source);
+};
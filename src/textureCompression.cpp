@@ -0,0 +1,389 @@
+#include "textureCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+	const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const uint32_t KTX_ENDIANNESS = 0x04030201;
+	const uint32_t GL_RGB_BASE = 0x1907;
+	const uint32_t GL_RGBA_BASE = 0x1908;
+
+	using Block = unsigned char[16][4];
+
+	uint16_t pack565(const float color[3]) {
+		auto channel = [](float value, int maxValue) {
+			return (uint16_t)std::lround(std::clamp(value, 0.0f, 255.0f) * maxValue / 255.0f);
+		};
+		return (uint16_t)(channel(color[0], 31) << 11 | channel(color[1], 63) << 5 | channel(color[2], 31));
+	}
+
+	void unpack565(uint16_t packed, int color[3]) {
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	void fetchBlock(const TextureCompression::MipLevel& level, int blockX, int blockY, Block& block) {
+		// Edge blocks repeat the last row/column so partial blocks don't pull in black
+		for (int y = 0; y < 4; y++) {
+			int sourceY = std::min(blockY * 4 + y, level.height - 1);
+			for (int x = 0; x < 4; x++) {
+				int sourceX = std::min(blockX * 4 + x, level.width - 1);
+				std::memcpy(block[y * 4 + x], &level.data[(sourceY * level.width + sourceX) * 4], 4);
+			}
+		}
+	}
+
+	void storeBlock(TextureCompression::MipLevel& level, int blockX, int blockY, const Block& block) {
+		for (int y = 0; y < 4 && blockY * 4 + y < level.height; y++) {
+			for (int x = 0; x < 4 && blockX * 4 + x < level.width; x++) {
+				std::memcpy(&level.data[((blockY * 4 + y) * level.width + blockX * 4 + x) * 4], block[y * 4 + x], 4);
+			}
+		}
+	}
+
+	// Endpoints are the extremes of the block projected onto its principal axis
+	void encodeColorBlock(const Block& block, unsigned char* out) {
+		float mean[3] = { 0, 0, 0 };
+		for (auto& pixel : block) {
+			for (int c = 0; c < 3; c++) {
+				mean[c] += pixel[c] / 16.0f;
+			}
+		}
+		float covariance[3][3] = {};
+		for (auto& pixel : block) {
+			float d[3] = { pixel[0] - mean[0], pixel[1] - mean[1], pixel[2] - mean[2] };
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					covariance[i][j] += d[i] * d[j];
+				}
+			}
+		}
+		float axis[3] = { 1, 1, 1 };
+		for (int iteration = 0; iteration < 8; iteration++) {
+			float next[3];
+			for (int i = 0; i < 3; i++) {
+				next[i] = covariance[i][0] * axis[0] + covariance[i][1] * axis[1] + covariance[i][2] * axis[2];
+			}
+			float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+			if (length < 1e-6f)
+				break;
+			for (int i = 0; i < 3; i++) {
+				axis[i] = next[i] / length;
+			}
+		}
+		float minT = 0, maxT = 0;
+		for (auto& pixel : block) {
+			float t = (pixel[0] - mean[0]) * axis[0] + (pixel[1] - mean[1]) * axis[1] + (pixel[2] - mean[2]) * axis[2];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		float high[3], low[3];
+		for (int c = 0; c < 3; c++) {
+			high[c] = mean[c] + axis[c] * maxT;
+			low[c] = mean[c] + axis[c] * minT;
+		}
+		uint16_t color0 = pack565(high);
+		uint16_t color1 = pack565(low);
+		// color0 > color1 selects the four colour mode
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		int palette[4][3];
+		unpack565(color0, palette[0]);
+		unpack565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1) {
+			for (int i = 0; i < 16; i++) {
+				int best = 0;
+				int bestDistance = INT32_MAX;
+				for (int p = 0; p < 4; p++) {
+					int distance = 0;
+					for (int c = 0; c < 3; c++) {
+						int d = block[i][c] - palette[p][c];
+						distance += d * d;
+					}
+					if (distance < bestDistance) {
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= uint32_t(best) << (i * 2);
+			}
+		}
+		out[0] = color0 & 0xFF;
+		out[1] = color0 >> 8;
+		out[2] = color1 & 0xFF;
+		out[3] = color1 >> 8;
+		for (int i = 0; i < 4; i++) {
+			out[4 + i] = (indices >> (i * 8)) & 0xFF;
+		}
+	}
+
+	void alphaPalette(int alpha0, int alpha1, int palette[8]) {
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		if (alpha0 > alpha1) {
+			for (int i = 1; i < 7; i++) {
+				palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+			}
+		}
+		else {
+			for (int i = 1; i < 5; i++) {
+				palette[i + 1] = ((5 - i) * alpha0 + i * alpha1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	void encodeAlphaBlock(const Block& block, unsigned char* out) {
+		int alpha0 = 0, alpha1 = 255;
+		for (auto& pixel : block) {
+			alpha0 = std::max<int>(alpha0, pixel[3]);
+			alpha1 = std::min<int>(alpha1, pixel[3]);
+		}
+		int palette[8];
+		alphaPalette(alpha0, alpha1, palette);
+		uint64_t indices = 0;
+		if (alpha0 != alpha1) {
+			for (int i = 0; i < 16; i++) {
+				int best = 0;
+				for (int p = 1; p < 8; p++) {
+					if (std::abs(block[i][3] - palette[p]) < std::abs(block[i][3] - palette[best]))
+						best = p;
+				}
+				indices |= uint64_t(best) << (i * 3);
+			}
+		}
+		out[0] = alpha0;
+		out[1] = alpha1;
+		for (int i = 0; i < 6; i++) {
+			out[2 + i] = (indices >> (i * 8)) & 0xFF;
+		}
+	}
+
+	void decodeColorBlock(const unsigned char* in, Block& block, bool alwaysFourColor) {
+		uint16_t color0 = in[0] | in[1] << 8;
+		uint16_t color1 = in[2] | in[3] << 8;
+		int palette[4][4];
+		unpack565(color0, palette[0]);
+		unpack565(color1, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+		if (color0 > color1 || alwaysFourColor) {
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+		else {
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			palette[3][3] = 0;
+		}
+		uint32_t indices = in[4] | in[5] << 8 | in[6] << 16 | uint32_t(in[7]) << 24;
+		for (int i = 0; i < 16; i++) {
+			auto& color = palette[(indices >> (i * 2)) & 3];
+			for (int c = 0; c < 4; c++) {
+				block[i][c] = color[c];
+			}
+		}
+	}
+
+	void decodeAlphaBlock(const unsigned char* in, Block& block) {
+		int palette[8];
+		alphaPalette(in[0], in[1], palette);
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++) {
+			indices |= uint64_t(in[2 + i]) << (i * 8);
+		}
+		for (int i = 0; i < 16; i++) {
+			block[i][3] = palette[(indices >> (i * 3)) & 7];
+		}
+	}
+
+	void writeU32(std::ofstream& file, uint32_t value) {
+		file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	uint32_t readU32(std::ifstream& file) {
+		uint32_t value = 0;
+		file.read(reinterpret_cast<char*>(&value), sizeof(value));
+		return value;
+	}
+}
+
+namespace TextureCompression {
+	std::size_t blockBytes(Format format) {
+		return format == Format::BC1 ? 8 : 16;
+	}
+
+	uint32_t glInternalFormat(Format format) {
+		return format == Format::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+
+	std::vector<MipLevel> generateMipmaps(const unsigned char* rgba, int width, int height) {
+		std::vector<MipLevel> levels;
+		levels.push_back({ width, height, std::vector<unsigned char>(rgba, rgba + std::size_t(width) * height * 4) });
+		while (levels.back().width > 1 || levels.back().height > 1) {
+			auto& previous = levels.back();
+			MipLevel next{ std::max(1, previous.width / 2), std::max(1, previous.height / 2), {} };
+			next.data.resize(std::size_t(next.width) * next.height * 4);
+			// 2x2 box filter, odd edges reuse their last texel
+			for (int y = 0; y < next.height; y++) {
+				int y0 = std::min(y * 2, previous.height - 1);
+				int y1 = std::min(y * 2 + 1, previous.height - 1);
+				for (int x = 0; x < next.width; x++) {
+					int x0 = std::min(x * 2, previous.width - 1);
+					int x1 = std::min(x * 2 + 1, previous.width - 1);
+					for (int c = 0; c < 4; c++) {
+						int sum = previous.data[(y0 * previous.width + x0) * 4 + c] + previous.data[(y0 * previous.width + x1) * 4 + c]
+							+ previous.data[(y1 * previous.width + x0) * 4 + c] + previous.data[(y1 * previous.width + x1) * 4 + c];
+						next.data[(y * next.width + x) * 4 + c] = (sum + 2) / 4;
+					}
+				}
+			}
+			levels.push_back(std::move(next));
+		}
+		return levels;
+	}
+
+	std::vector<unsigned char> encode(const MipLevel& rgbaLevel, Format format) {
+		int blocksWide = (rgbaLevel.width + 3) / 4;
+		int blocksHigh = (rgbaLevel.height + 3) / 4;
+		std::size_t size = blockBytes(format);
+		std::vector<unsigned char> out(blocksWide * blocksHigh * size);
+		Block block;
+		for (int by = 0; by < blocksHigh; by++) {
+			for (int bx = 0; bx < blocksWide; bx++) {
+				fetchBlock(rgbaLevel, bx, by, block);
+				unsigned char* destination = out.data() + (by * blocksWide + bx) * size;
+				if (format == Format::BC3) {
+					encodeAlphaBlock(block, destination);
+					destination += 8;
+				}
+				encodeColorBlock(block, destination);
+			}
+		}
+		return out;
+	}
+
+	std::vector<unsigned char> decode(const MipLevel& compressedLevel, Format format) {
+		MipLevel rgba{ compressedLevel.width, compressedLevel.height, {} };
+		rgba.data.resize(std::size_t(rgba.width) * rgba.height * 4);
+		int blocksWide = (rgba.width + 3) / 4;
+		int blocksHigh = (rgba.height + 3) / 4;
+		std::size_t size = blockBytes(format);
+		Block block;
+		for (int by = 0; by < blocksHigh; by++) {
+			for (int bx = 0; bx < blocksWide; bx++) {
+				const unsigned char* source = compressedLevel.data.data() + (by * blocksWide + bx) * size;
+				if (format == Format::BC3) {
+					decodeColorBlock(source + 8, block, true);
+					decodeAlphaBlock(source, block);
+				}
+				else {
+					decodeColorBlock(source, block, false);
+				}
+				storeBlock(rgba, bx, by, block);
+			}
+		}
+		return rgba.data;
+	}
+
+	CompressedImage compress(const unsigned char* rgba, int width, int height, Format format) {
+		CompressedImage image{ format, {} };
+		for (auto& level : generateMipmaps(rgba, width, height)) {
+			image.levels.push_back({ level.width, level.height, encode(level, format) });
+		}
+		return image;
+	}
+
+	void writeKtx(const std::filesystem::path& p, const CompressedImage& image) {
+		std::ofstream file{ p, std::ios::binary };
+		if (!file.is_open())
+			throw std::runtime_error(p.string() + " could not be written");
+		file.write(reinterpret_cast<const char*>(KTX_IDENTIFIER), sizeof(KTX_IDENTIFIER));
+		writeU32(file, KTX_ENDIANNESS);
+		writeU32(file, 0); // glType, compressed
+		writeU32(file, 1); // glTypeSize
+		writeU32(file, 0); // glFormat, compressed
+		writeU32(file, glInternalFormat(image.format));
+		writeU32(file, image.format == Format::BC1 ? GL_RGB_BASE : GL_RGBA_BASE);
+		writeU32(file, image.levels[0].width);
+		writeU32(file, image.levels[0].height);
+		writeU32(file, 0); // depth
+		writeU32(file, 0); // array elements
+		writeU32(file, 1); // faces
+		writeU32(file, image.levels.size());
+		writeU32(file, 0); // key value data
+		for (auto& level : image.levels) {
+			// Block sizes are multiples of four so no mip padding is needed
+			writeU32(file, level.data.size());
+			file.write(reinterpret_cast<const char*>(level.data.data()), level.data.size());
+		}
+	}
+
+	CompressedImage readKtx(const std::filesystem::path& p) {
+		std::ifstream file{ p, std::ios::binary };
+		if (!file.is_open())
+			throw std::runtime_error(p.string() + " could not be read");
+		unsigned char identifier[12];
+		file.read(reinterpret_cast<char*>(identifier), sizeof(identifier));
+		if (!file || std::memcmp(identifier, KTX_IDENTIFIER, sizeof(identifier)) != 0)
+			throw std::runtime_error(p.string() + " is not a KTX file");
+		if (readU32(file) != KTX_ENDIANNESS)
+			throw std::runtime_error(p.string() + " has unsupported endianness");
+		uint32_t glType = readU32(file);
+		readU32(file);
+		readU32(file);
+		uint32_t internalFormat = readU32(file);
+		readU32(file);
+		int width = readU32(file);
+		int height = readU32(file);
+		uint32_t depth = readU32(file);
+		uint32_t arrayElements = readU32(file);
+		uint32_t faces = readU32(file);
+		uint32_t levelCount = std::max<uint32_t>(1, readU32(file));
+		uint32_t keyValueBytes = readU32(file);
+		if (glType != 0 || depth > 1 || arrayElements > 0 || faces != 1)
+			throw std::runtime_error(p.string() + " is not a compressed 2D texture");
+
+		CompressedImage image;
+		if (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+			image.format = Format::BC1;
+		else if (internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+			image.format = Format::BC3;
+		else
+			throw std::runtime_error(p.string() + " uses an unsupported format");
+
+		file.seekg(keyValueBytes, std::ios::cur);
+		for (uint32_t i = 0; i < levelCount; i++) {
+			MipLevel level{ std::max(1, width >> i), std::max(1, height >> i), {} };
+			uint32_t size = readU32(file);
+			std::size_t expected = ((level.width + 3) / 4) * ((level.height + 3) / 4) * blockBytes(image.format);
+			if (size != expected)
+				throw std::runtime_error(p.string() + " has a truncated mip level");
+			level.data.resize(size);
+			file.read(reinterpret_cast<char*>(level.data.data()), size);
+			if (!file)
+				throw std::runtime_error(p.string() + " has a truncated mip level");
+			file.seekg((4 - size % 4) % 4, std::ios::cur);
+			image.levels.push_back(std::move(level));
+		}
+		return image;
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// S3TC formats are an extension on desktop GL so the loader headers don't define them
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Block compression and KTX containers for textures prepared offline.
+// Everything in here is CPU only so the offline encoder can use it without a GL context.
+namespace TextureCompression {
+	enum class Format {
+		BC1,
+		BC3
+	};
+
+	struct MipLevel {
+		int width;
+		int height;
+		std::vector<unsigned char> data;
+	};
+
+	struct CompressedImage {
+		Format format;
+		std::vector<MipLevel> levels;
+	};
+
+	std::size_t blockBytes(Format format);
+	uint32_t glInternalFormat(Format format);
+
+	// RGBA8 input, returns the full mip chain down to 1x1 starting with the image itself
+	std::vector<MipLevel> generateMipmaps(const unsigned char* rgba, int width, int height);
+
+	std::vector<unsigned char> encode(const MipLevel& rgbaLevel, Format format);
+	// Back to RGBA8, for drivers without S3TC support
+	std::vector<unsigned char> decode(const MipLevel& compressedLevel, Format format);
+
+	CompressedImage compress(const unsigned char* rgba, int width, int height, Format format);
+
+	void writeKtx(const std::filesystem::path& p, const CompressedImage& image);
+	// Throws std::runtime_error on anything but a 2D BC1/BC3 KTX 1.1 file
+	CompressedImage readKtx(const std::filesystem::path& p);
+}
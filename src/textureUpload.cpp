@@ -0,0 +1,103 @@
+#include "textureUpload.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+	bool sameFormat(const PixelFormat& a, const PixelFormat& b) {
+		return a.internalFormat == b.internalFormat && a.format == b.format && a.type == b.type && a.clientBytes == b.clientBytes;
+	}
+}
+
+TextureUploader::TextureUploader(std::size_t _stagingBytes, std::size_t ringSize, std::size_t _frameBudget) :
+	ring(std::max<std::size_t>(1, ringSize)), stagingBytes(_stagingBytes), frameBudget(_frameBudget) {
+	for (auto& staging : ring) {
+		glGenBuffers(1, &staging.buffer);
+	}
+}
+
+TextureUploader::~TextureUploader() {
+	for (auto& staging : ring) {
+		if (staging.fence)
+			glDeleteSync(staging.fence);
+		glDeleteBuffers(1, &staging.buffer);
+	}
+}
+
+void TextureUploader::enqueue(std::shared_ptr<Texture> texture, ImageData image) {
+	if (!image.pixels)
+		return;
+	if (texture->width != image.width || texture->height != image.height ||
+		texture->pixelFormat.clientBytes != PixelFormat::negotiate(image.channels, image.depth).clientBytes) {
+		std::cout << "Texture storage doesn't match the queued image, skipping upload" << std::endl;
+		return;
+	}
+	unsigned int textureId = texture->textureId;
+	uint64_t version = texture->version;
+	PixelFormat format = texture->pixelFormat;
+	queue.push_back({ std::move(texture), std::move(image), 0, textureId, version, format });
+}
+
+bool TextureUploader::claim(Staging& staging) {
+	if (staging.fence == nullptr)
+		return true;
+	GLenum status = glClientWaitSync(staging.fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+	glDeleteSync(staging.fence);
+	staging.fence = nullptr;
+	return true;
+}
+
+std::size_t TextureUploader::process() {
+	std::size_t uploaded = 0;
+	while (!queue.empty() && uploaded < frameBudget) {
+		auto& upload = queue.front();
+		auto& texture = *upload.texture;
+		// Evicted, reloaded or restored while waiting, the queued pixels may not even fit the texture now
+		if (texture.textureId != upload.textureId || texture.version != upload.version || !sameFormat(texture.pixelFormat, upload.format) ||
+			texture.width != upload.image.width || texture.height != upload.image.height) {
+			queue.pop_front();
+			continue;
+		}
+		auto& staging = ring[nextStaging];
+		if (!claim(staging))
+			break;
+
+		// Whole rows per transfer, always at least one so a single wide row can't stall the queue
+		std::size_t rowBytes = std::size_t(upload.image.width) * upload.format.clientBytes;
+		std::size_t available = std::min(stagingBytes, frameBudget - uploaded);
+		int rows = std::clamp<int>(available / rowBytes, 1, texture.height - upload.nextRow);
+		std::size_t bytes = rows * rowBytes;
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+		if (staging.capacity < bytes) {
+			staging.capacity = std::max(bytes, stagingBytes);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, staging.capacity, nullptr, GL_STREAM_DRAW);
+		}
+		// The fence already guarantees the GPU is done with the buffer
+		void* destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (destination == nullptr) {
+			std::cout << "Failed to map texture staging buffer" << std::endl;
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			break;
+		}
+		std::memcpy(destination, upload.image.pixels.get() + upload.nextRow * rowBytes, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		bool last = upload.nextRow + rows == texture.height;
+		texture.update(0, upload.nextRow, texture.width, rows, nullptr, last);
+		upload.version = texture.version;
+		staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		// Anything else uploading from client memory must not see the buffer
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		nextStaging = (nextStaging + 1) % ring.size();
+
+		uploaded += bytes;
+		upload.nextRow += rows;
+		if (last)
+			queue.pop_front();
+	}
+	return uploaded;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "texture.h"
+
+// Streams pixels into textures through a ring of pixel unpack buffers so the driver copies them
+// asynchronously. Each buffer is fenced after use and only refilled once the GPU is done with it,
+// and no more than frameBudget bytes are staged per frame so big images spread over several frames.
+class TextureUploader {
+	struct Staging {
+		GLuint buffer = 0;
+		std::size_t capacity = 0;
+		GLsync fence = nullptr;
+	};
+	struct Upload {
+		std::shared_ptr<Texture> texture;
+		ImageData image;
+		int nextRow = 0;
+		// What the texture looked like when queued, anything else touching it makes the upload stale
+		unsigned int textureId;
+		uint64_t version;
+		PixelFormat format;
+	};
+	std::vector<Staging> ring;
+	std::size_t nextStaging = 0;
+	std::size_t stagingBytes;
+	std::deque<Upload> queue;
+
+	// False while the GPU still reads from the buffer
+	bool claim(Staging& staging);
+public:
+	std::size_t frameBudget;
+
+	TextureUploader(std::size_t stagingBytes = std::size_t(4) << 20, std::size_t ringSize = 3,
+		std::size_t frameBudget = std::size_t(8) << 20);
+	TextureUploader(const TextureUploader&) = delete;
+	TextureUploader& operator=(const TextureUploader&) = delete;
+	~TextureUploader();
+
+	// The texture needs storage matching image already, see ImageTexture::Allocate
+	void enqueue(std::shared_ptr<Texture> texture, ImageData image);
+	// Stages up to frameBudget bytes and returns how many were sent, call once per frame on the GL thread
+	std::size_t process();
+	std::size_t pending() const { return queue.size(); }
+};
@@ -0,0 +1,83 @@
+#include "transformBatch.h"
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include "simd.h"
+
+namespace {
+	glm::mat4& at(glm::mat4* out, std::size_t stride, std::size_t i) {
+		return *reinterpret_cast<glm::mat4*>(reinterpret_cast<unsigned char*>(out) + i * stride);
+	}
+
+	void write(glm::mat4& m, float cosine, float sine, float scaleX, float scaleY, float x, float y, float z) {
+		m[0] = glm::vec4(cosine * scaleX, sine * scaleX, 0.0f, 0.0f);
+		m[1] = glm::vec4(-sine * scaleY, cosine * scaleY, 0.0f, 0.0f);
+		m[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+		m[3] = glm::vec4(x, y, z, 1.0f);
+	}
+
+	// Cephes style sinf/cosf: take off multiples of pi/2 in three parts to keep precision, evaluate
+	// both polynomials on [-pi/4, pi/4] and swap or negate them by quadrant.
+	void sinCos(Simd::Float angle, Simd::Float& sine, Simd::Float& cosine) {
+		using namespace Simd;
+		Float quadrant = round(mul(angle, splat(0.63661977236f)));
+		Float r = sub(angle, mul(quadrant, splat(1.5703125f)));
+		r = sub(r, mul(quadrant, splat(4.837512969970703125e-4f)));
+		r = sub(r, mul(quadrant, splat(7.54978995489188216e-8f)));
+		Float r2 = mul(r, r);
+
+		Float s = splat(-1.9515295891e-4f);
+		s = add(mul(s, r2), splat(8.3321608736e-3f));
+		s = add(mul(s, r2), splat(-1.6666654611e-1f));
+		s = add(mul(mul(s, r2), r), r);
+
+		Float c = splat(2.443315711809948e-5f);
+		c = add(mul(c, r2), splat(-1.388731625493765e-3f));
+		c = add(mul(c, r2), splat(4.166664568298827e-2f));
+		c = add(sub(mul(mul(c, r2), r2), mul(r2, splat(0.5f))), splat(1.0f));
+
+		// Quadrant modulo 4 in floats, AVX has no integer vectors
+		Float wrapped = sub(quadrant, mul(splat(4.0f), round(sub(mul(quadrant, splat(0.25f)), splat(0.375f)))));
+		Float odd = sub(wrapped, mul(splat(2.0f), round(sub(mul(wrapped, splat(0.5f)), splat(0.25f)))));
+		Mask swap = equal(odd, splat(1.0f));
+		Float positive = splat(1.0f), negative = splat(-1.0f);
+		Float sineSign = select(greaterEqual(wrapped, splat(2.0f)), negative, positive);
+		Float cosineSign = select(equal(wrapped, splat(1.0f)), negative, select(equal(wrapped, splat(2.0f)), negative, positive));
+		sine = mul(select(swap, c, s), sineSign);
+		cosine = mul(select(swap, s, c), cosineSign);
+	}
+}
+
+void Transforms::compose(const TransformArrays& in, std::size_t count, glm::mat4* out, std::size_t stride) {
+	std::size_t i = 0;
+	for (; i + Simd::width <= count; i += Simd::width) {
+		Simd::Float sine, cosine;
+		sinCos(Simd::load(in.rotation + i), sine, cosine);
+		Simd::Float scaleX = Simd::load(in.scaleX + i);
+		Simd::Float scaleY = Simd::load(in.scaleY + i);
+		// The four rotation and scale entries are vectorised, the rest of each matrix is constant
+		// or copied and goes out lane by lane
+		float xx[Simd::width], xy[Simd::width], yx[Simd::width], yy[Simd::width];
+		Simd::store(xx, Simd::mul(cosine, scaleX));
+		Simd::store(xy, Simd::mul(sine, scaleX));
+		Simd::store(yx, Simd::mul(Simd::sub(Simd::splat(0.0f), sine), scaleY));
+		Simd::store(yy, Simd::mul(cosine, scaleY));
+		for (std::size_t lane = 0; lane < Simd::width; lane++) {
+			auto& m = at(out, stride, i + lane);
+			m[0] = glm::vec4(xx[lane], xy[lane], 0.0f, 0.0f);
+			m[1] = glm::vec4(yx[lane], yy[lane], 0.0f, 0.0f);
+			m[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+			m[3] = glm::vec4(in.x[i + lane], in.y[i + lane], in.z[i + lane], 1.0f);
+		}
+	}
+	for (; i < count; i++) {
+		write(at(out, stride, i), std::cos(in.rotation[i]), std::sin(in.rotation[i]), in.scaleX[i], in.scaleY[i], in.x[i], in.y[i], in.z[i]);
+	}
+}
+
+void Transforms::composeReference(const TransformArrays& in, std::size_t count, glm::mat4* out, std::size_t stride) {
+	for (std::size_t i = 0; i < count; i++) {
+		auto transform = glm::translate(glm::mat4(1.0f), glm::vec3(in.x[i], in.y[i], in.z[i]));
+		transform = glm::rotate(transform, in.rotation[i], glm::vec3(0.0f, 0.0f, 1.0f));
+		at(out, stride, i) = glm::scale(transform, glm::vec3(in.scaleX[i], in.scaleY[i], 1.0f));
+	}
+}
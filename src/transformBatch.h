@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <glm/mat4x4.hpp>
+
+// 2D transforms with one array per component. Each composes to
+// translate(x, y, z) * rotate(rotation around z) * scale(scaleX, scaleY, 1), the chain sprites are built with.
+struct TransformArrays {
+	const float* x;
+	const float* y;
+	const float* z;
+	// Radians
+	const float* rotation;
+	const float* scaleX;
+	const float* scaleY;
+};
+
+namespace Transforms {
+	// Writes count matrices from out onwards, stride bytes apart so they can go straight into structs
+	// holding a matrix like Sprite. Sine and cosine come from a SIMD polynomial good to a few ulps for
+	// angles within a few thousand radians.
+	void compose(const TransformArrays& in, std::size_t count, glm::mat4* out, std::size_t stride = sizeof(glm::mat4));
+	// The same through chained glm calls, what compose is checked against
+	void composeReference(const TransformArrays& in, std::size_t count, glm::mat4* out, std::size_t stride = sizeof(glm::mat4));
+}
@@ -10,3 +10,124 @@ namespace Math
         return ((val - inMin) / (inMax - inMin)) * (outMax - outMin)  + outMin; 
     }
 }
+
+namespace Unicode
+{
+    static const std::uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+    std::vector<std::uint32_t> decodeUtf8(const std::string& text) {
+        std::vector<std::uint32_t> codepoints;
+        codepoints.reserve(text.length());
+        std::size_t i = 0;
+        while (i < text.length()) {
+            unsigned char lead = text[i];
+            std::uint32_t codepoint;
+            int continuation;
+            if (lead < 0x80) {
+                codepoint = lead;
+                continuation = 0;
+            } else if ((lead & 0xE0) == 0xC0) {
+                codepoint = lead & 0x1F;
+                continuation = 1;
+            } else if ((lead & 0xF0) == 0xE0) {
+                codepoint = lead & 0x0F;
+                continuation = 2;
+            } else if ((lead & 0xF8) == 0xF0) {
+                codepoint = lead & 0x07;
+                continuation = 3;
+            } else {
+                codepoints.push_back(REPLACEMENT_CHARACTER);
+                i++;
+                continue;
+            }
+            i++;
+            bool valid = true;
+            for (int j = 0; j < continuation; j++, i++) {
+                if (i >= text.length() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+                    valid = false;
+                    break;
+                }
+                codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+            }
+            codepoints.push_back(valid && codepoint <= 0x10FFFF ? codepoint : REPLACEMENT_CHARACTER);
+        }
+        return codepoints;
+    }
+}
+
+namespace Parallel
+{
+    WorkerPool::WorkerPool(unsigned int threads) {
+        workers.reserve(threads);
+        for (unsigned int i = 0; i < threads; i++) {
+            workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    WorkerPool& WorkerPool::shared() {
+        static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    std::size_t WorkerPool::help(Job& job) {
+        std::size_t ran = 0;
+        for (std::size_t i = job.next++; i < job.chunks; i = job.next++) {
+            (*job.fn)(i);
+            ran++;
+        }
+        return ran;
+    }
+
+    void WorkerPool::work() {
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                job = queue.front();
+                queue.pop_front();
+            }
+            // Stale entries for jobs already finished by others find no chunks and never touch fn
+            std::size_t ran = help(*job);
+            if (ran > 0 && (job->finished += ran) == job->chunks) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+
+    void WorkerPool::run(std::size_t chunks, unsigned int helpers, const std::function<void(std::size_t)>& fn) {
+        auto job = std::make_shared<Job>();
+        job->fn = &fn;
+        job->chunks = chunks;
+        helpers = std::min(helpers, size());
+        if (helpers > 0) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (unsigned int i = 0; i < helpers; i++) {
+                    queue.push_back(job);
+                }
+            }
+            if (helpers == 1)
+                wake.notify_one();
+            else
+                wake.notify_all();
+        }
+        job->finished += help(*job);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&job]() { return job->finished == job->chunks; });
+    }
+}
@@ -1,9 +1,78 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace Math {
     float lerp(float val, float inMin, float inMax);
 
     float map(float val, float inMin, float inMax, float outMin, float outMax);
 }
+
+namespace Unicode {
+    // Decodes a UTF-8 string into codepoints, replacing malformed sequences with U+FFFD
+    std::vector<std::uint32_t> decodeUtf8(const std::string& text);
+}
+
+namespace Parallel {
+    // Threads started once and reused by every forRange, so short parallel loops run every frame
+    // or per bitmap don't pay for creating and joining threads each time
+    class WorkerPool {
+        struct Job {
+            const std::function<void(std::size_t)>* fn;
+            std::size_t chunks;
+            std::atomic<std::size_t> next { 0 };
+            std::atomic<std::size_t> finished { 0 };
+        };
+        std::vector<std::thread> workers;
+        std::deque<std::shared_ptr<Job>> queue;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        bool stopping = false;
+
+        void work();
+        // Runs chunks of the job until none are left, returns how many this thread ran
+        std::size_t help(Job& job);
+    public:
+        explicit WorkerPool(unsigned int threads);
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+        ~WorkerPool();
+
+        // Runs fn(i) for every i in [0, chunks) with up to helpers workers joining in. The calling
+        // thread takes chunks as well, so calls from inside a worker can't deadlock the pool.
+        void run(std::size_t chunks, unsigned int helpers, const std::function<void(std::size_t)>& fn);
+        unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+        // One worker per core besides the calling thread
+        static WorkerPool& shared();
+    };
+
+    // Splits [0, count) into contiguous chunks, one per thread, and runs fn(begin, end) for each on
+    // the shared pool, the calling thread included
+    template<typename Fn>
+    void forRange(std::size_t count, unsigned int threads, Fn&& fn) {
+        threads = std::max(1u, std::min<unsigned int>(threads, count));
+        if (threads <= 1) {
+            if (count > 0)
+                fn(std::size_t(0), count);
+            return;
+        }
+        std::size_t chunk = (count + threads - 1) / threads;
+        std::size_t chunks = (count + chunk - 1) / chunk;
+        std::function<void(std::size_t)> runChunk = [&fn, chunk, count](std::size_t i) {
+            fn(i * chunk, std::min(count, (i + 1) * chunk));
+        };
+        WorkerPool::shared().run(chunks, static_cast<unsigned int>(chunks - 1), runChunk);
+    }
+}
@@ -0,0 +1,199 @@
+#include "vertexLayout.h"
+#include <algorithm>
+
+VertexLayout VertexLayout::floats(GLuint location, GLint components) {
+    return { { { location, components, 1, GL_FLOAT, false, 0 } }, GLsizei(components * sizeof(float)), 0 };
+}
+
+void VertexLayout::apply(std::size_t baseOffset) const {
+    for (auto& attribute : attributes) {
+        for (GLint column = 0; column < attribute.columns; column++) {
+            GLuint location = attribute.location + column;
+            auto offset = (const void*)(baseOffset + attribute.offset + column * attribute.components * sizeof(float));
+            if (attribute.type == GL_FLOAT || attribute.normalized)
+                glVertexAttribPointer(location, attribute.components, attribute.type, attribute.normalized, stride, offset);
+            else
+                glVertexAttribIPointer(location, attribute.components, attribute.type, stride, offset);
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, divisor);
+        }
+    }
+}
+
+IndexBuffer::IndexBuffer() {
+    glGenBuffers(1, &id);
+}
+
+IndexBuffer::~IndexBuffer() {
+    glDeleteBuffers(1, &id);
+}
+
+namespace {
+    template <typename Index>
+    std::vector<Index> quadPattern(std::size_t quadCount) {
+        std::vector<Index> pattern;
+        pattern.reserve(quadCount * 6);
+        for (std::size_t quad = 0; quad < quadCount; quad++) {
+            Index first = Index(quad * 4);
+            for (Index offset : { 0, 1, 2, 2, 1, 3 }) {
+                pattern.push_back(first + offset);
+            }
+        }
+        return pattern;
+    }
+}
+
+std::shared_ptr<IndexBuffer> quadIndices(std::size_t quadCount) {
+    // Vertex arrays keep the buffer they were given alive, a bigger request only replaces the cached one
+    static std::weak_ptr<IndexBuffer> cached;
+    auto buffer = cached.lock();
+    if (buffer && buffer->count >= quadCount * 6)
+        return buffer;
+    std::size_t quads = std::max<std::size_t>(quadCount, 1024);
+    if (buffer)
+        quads = std::max(quads, buffer->count / 3);
+    buffer = std::make_shared<IndexBuffer>();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->id);
+    if (quads * 4 <= 0x10000) {
+        auto pattern = quadPattern<std::uint16_t>(quads);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, pattern.size() * sizeof(std::uint16_t), pattern.data(), GL_STATIC_DRAW);
+        buffer->type = GL_UNSIGNED_SHORT;
+        buffer->capacity = pattern.size() * sizeof(std::uint16_t);
+    }
+    else {
+        auto pattern = quadPattern<std::uint32_t>(quads);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, pattern.size() * sizeof(std::uint32_t), pattern.data(), GL_STATIC_DRAW);
+        buffer->type = GL_UNSIGNED_INT;
+        buffer->capacity = pattern.size() * sizeof(std::uint32_t);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    buffer->count = quads * 6;
+    cached = buffer;
+    return buffer;
+}
+
+VertexArray::VertexArray(VertexLayout _layout, GLenum _usage) : usage(_usage), layout(std::move(_layout)) {
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    layout.apply();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+VertexArray::~VertexArray() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+}
+
+void VertexArray::setVertexData(const void* data, std::size_t bytes, std::size_t count) {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (bytes > vertexCapacity) {
+        glBufferData(GL_ARRAY_BUFFER, bytes, data, usage);
+        vertexCapacity = bytes;
+    }
+    else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vertexCount = count;
+    updateQuadIndices();
+}
+
+void VertexArray::attachIndices(std::shared_ptr<IndexBuffer> buffer) {
+    // The element buffer binding is part of the vertex array state
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->id);
+    glBindVertexArray(0);
+    indices = std::move(buffer);
+}
+
+void VertexArray::setIndexData(const void* data, std::size_t bytes, std::size_t count, GLenum type) {
+    // Never write into the shared quad pattern
+    if (!indices || quadIndexed)
+        attachIndices(std::make_shared<IndexBuffer>());
+    quadIndexed = false;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices->id);
+    if (bytes > indices->capacity) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, data, usage);
+        indices->capacity = bytes;
+    }
+    else {
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, bytes, data);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    indices->type = type;
+    indices->count = count;
+    indexCount = count;
+}
+
+void VertexArray::setIndices(const std::vector<std::uint16_t>& indices) {
+    setIndexData(indices.data(), indices.size() * sizeof(std::uint16_t), indices.size(), GL_UNSIGNED_SHORT);
+}
+
+void VertexArray::setIndices(const std::vector<std::uint32_t>& indices) {
+    setIndexData(indices.data(), indices.size() * sizeof(std::uint32_t), indices.size(), GL_UNSIGNED_INT);
+}
+
+void VertexArray::setQuadIndexing(bool enabled) {
+    if (enabled == quadIndexed)
+        return;
+    quadIndexed = enabled;
+    if (enabled) {
+        attachIndices(quadIndices(vertexCount / 4));
+        updateQuadIndices();
+    }
+    else {
+        indices.reset();
+        indexCount = 0;
+    }
+}
+
+void VertexArray::updateQuadIndices() {
+    if (!quadIndexed)
+        return;
+    std::size_t quads = vertexCount / 4;
+    if (!indices || indices->count < quads * 6)
+        attachIndices(quadIndices(quads));
+    indexCount = quads * 6;
+}
+
+void VertexArray::addBuffer(GLuint buffer, const VertexLayout& bufferLayout, std::size_t byteOffset) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    bufferLayout.apply(byteOffset);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexArray::bind() const {
+    glBindVertexArray(vao);
+}
+
+void VertexArray::draw(GLenum mode) const {
+    bind();
+    if (indexCount > 0)
+        glDrawElements(mode, indexCount, indices->type, nullptr);
+    else
+        glDrawArrays(mode, 0, vertexCount);
+}
+
+void VertexArray::drawInstanced(GLsizei instances, GLenum mode) const {
+    bind();
+    if (indexCount > 0)
+        glDrawElementsInstanced(mode, indexCount, indices->type, nullptr, instances);
+    else
+        glDrawArraysInstanced(mode, 0, vertexCount, instances);
+}
+
+void VertexArray::drawRange(std::size_t first, std::size_t count, GLenum mode) const {
+    bind();
+    if (indexCount > 0) {
+        std::size_t indexBytes = indices->type == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+        glDrawElements(mode, count, indices->type, (const void*)(first * indexBytes));
+    }
+    else {
+        glDrawArrays(mode, first, count);
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+// How a C++ type maps onto a vertex attribute, specialized for the types vertices are built from
+template <typename T>
+struct AttributeTraits;
+
+template <> struct AttributeTraits<float> { static constexpr GLint components = 1; static constexpr GLint columns = 1; static constexpr GLenum type = GL_FLOAT; };
+template <> struct AttributeTraits<glm::vec2> { static constexpr GLint components = 2; static constexpr GLint columns = 1; static constexpr GLenum type = GL_FLOAT; };
+template <> struct AttributeTraits<glm::vec3> { static constexpr GLint components = 3; static constexpr GLint columns = 1; static constexpr GLenum type = GL_FLOAT; };
+template <> struct AttributeTraits<glm::vec4> { static constexpr GLint components = 4; static constexpr GLint columns = 1; static constexpr GLenum type = GL_FLOAT; };
+// Matrices take one location per column
+template <> struct AttributeTraits<glm::mat4> { static constexpr GLint components = 4; static constexpr GLint columns = 4; static constexpr GLenum type = GL_FLOAT; };
+template <> struct AttributeTraits<std::int32_t> { static constexpr GLint components = 1; static constexpr GLint columns = 1; static constexpr GLenum type = GL_INT; };
+template <> struct AttributeTraits<std::uint32_t> { static constexpr GLint components = 1; static constexpr GLint columns = 1; static constexpr GLenum type = GL_UNSIGNED_INT; };
+
+// Colour with a byte per channel, read as normalized floats when the attribute is normalized
+struct Rgba8 {
+    std::uint8_t r, g, b, a;
+};
+template <> struct AttributeTraits<Rgba8> { static constexpr GLint components = 4; static constexpr GLint columns = 1; static constexpr GLenum type = GL_UNSIGNED_BYTE; };
+
+struct VertexAttribute {
+    GLuint location;
+    GLint components;
+    GLint columns;
+    GLenum type;
+    // Integer attributes reach the shader unconverted unless normalized is set
+    bool normalized;
+    std::size_t offset;
+};
+
+template <typename T>
+constexpr VertexAttribute attribute(GLuint location, std::size_t offset, bool normalized = false) {
+    return { location, AttributeTraits<T>::components, AttributeTraits<T>::columns, AttributeTraits<T>::type, normalized, offset };
+}
+
+// Vertex structs describe themselves by specializing this with a static constexpr `attributes` array:
+//     template <> struct VertexDescription<MyVertex> {
+//         static constexpr VertexAttribute attributes[] = { attribute<glm::vec2>(0, offsetof(MyVertex, position)) };
+//     };
+template <typename Vertex>
+struct VertexDescription;
+
+struct VertexLayout {
+    std::vector<VertexAttribute> attributes;
+    GLsizei stride = 0;
+    // 0 advances per vertex, 1 per instance
+    GLuint divisor = 0;
+
+    template <typename Vertex>
+    static VertexLayout of(GLuint divisor = 0) {
+        auto& described = VertexDescription<Vertex>::attributes;
+        return { std::vector<VertexAttribute>(std::begin(described), std::end(described)), (GLsizei)sizeof(Vertex), divisor };
+    }
+    // Tightly packed floats in a single attribute, the layout of plain position arrays
+    static VertexLayout floats(GLuint location, GLint components);
+
+    // Points the attributes at the buffer bound to GL_ARRAY_BUFFER, for the bound vertex array.
+    // baseOffset skips that many bytes at the start of the buffer.
+    void apply(std::size_t baseOffset = 0) const;
+};
+
+// Element buffer that several vertex arrays can share
+struct IndexBuffer {
+    GLuint id = 0;
+    GLenum type = GL_UNSIGNED_INT;
+    // Indices the buffer holds
+    std::size_t count = 0;
+    std::size_t capacity = 0;
+    IndexBuffer();
+    IndexBuffer(const IndexBuffer&) = delete;
+    IndexBuffer& operator=(const IndexBuffer&) = delete;
+    ~IndexBuffer();
+};
+
+// Shared 0,1,2, 2,1,3 pattern covering at least quadCount quads, so quads need four vertices
+// instead of six. Vertices go top right, bottom right, top left, bottom left.
+std::shared_ptr<IndexBuffer> quadIndices(std::size_t quadCount);
+
+// A vertex array object with its interleaved vertex buffer and an optional index buffer
+class VertexArray {
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    std::shared_ptr<IndexBuffer> indices;
+    std::size_t vertexCapacity = 0;
+    std::size_t vertexCount = 0;
+    std::size_t indexCount = 0;
+    bool quadIndexed = false;
+    GLenum usage;
+
+    void setIndexData(const void* data, std::size_t bytes, std::size_t count, GLenum type);
+    void attachIndices(std::shared_ptr<IndexBuffer> buffer);
+    void updateQuadIndices();
+public:
+    const VertexLayout layout;
+
+    VertexArray(VertexLayout layout, GLenum usage = GL_STATIC_DRAW);
+    VertexArray(const VertexArray&) = delete;
+    VertexArray& operator=(const VertexArray&) = delete;
+    ~VertexArray();
+
+    template <typename Vertex>
+    void setVertices(const std::vector<Vertex>& vertices) {
+        setVertexData(vertices.data(), sizeof(Vertex) * vertices.size(), vertices.size());
+    }
+    // Reuses the buffer storage when the data fits
+    void setVertexData(const void* data, std::size_t bytes, std::size_t count);
+    void setIndices(const std::vector<std::uint16_t>& indices);
+    void setIndices(const std::vector<std::uint32_t>& indices);
+    // Draws every four vertices as a quad through the shared quad index buffer
+    void setQuadIndexing(bool enabled);
+
+    // Attaches an extra buffer, e.g. per instance data, described by its own layout. Attaching the
+    // same buffer again at another byteOffset lets instanced draws start part way into it.
+    void addBuffer(GLuint buffer, const VertexLayout& bufferLayout, std::size_t byteOffset = 0);
+
+    GLuint id() const { return vao; }
+    std::size_t count() const { return indexCount > 0 ? indexCount : vertexCount; }
+    void bind() const;
+    // Draws indexed when indices were set
+    void draw(GLenum mode = GL_TRIANGLES) const;
+    void drawInstanced(GLsizei instances, GLenum mode = GL_TRIANGLES) const;
+    // Draws count indices, or vertices when not indexed, starting at first
+    void drawRange(std::size_t first, std::size_t count, GLenum mode = GL_TRIANGLES) const;
+};
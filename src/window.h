@@ -7,6 +7,7 @@
 #include <cstdlib>
 #include <cmath>
 #include <random>
+#include <algorithm>
 #include <unordered_set>
 #include <glm/matrix.hpp>
 #include <glm/mat4x4.hpp> 
@@ -24,9 +25,16 @@ class PerspectiveCamera;
 #include "mesh.h"
 #include "camera.h"
 #include "text.h"
+#include "glyphCache.h"
+#include "renderTarget.h"
+#include "dynamicResolution.h"
+#include "particles.h"
+#include "transformBatch.h"
 
 
 #include "resourceLoader.h"
+#include "hotReload.h"
+#include "resourceManager.h"
 
 using std::string;
 using std::cout;
@@ -55,6 +63,8 @@ public:
     unordered_set<int> mouseReleased;
     double mouseX;
     double mouseY;
+    // Offscreen targets for this window's passes, screen sized ones follow the framebuffer size
+    std::unique_ptr<RenderTargetPool> renderTargets;
 
     Window(string windowName, unsigned int w, unsigned int h) : Name(windowName), Width(w), Height(h) {
         id = windowsCreated++;
@@ -85,12 +95,20 @@ public:
                 std::cout << "Failed to initialize OpenGL context" << std::endl;
                 return;
             }
+            // glad only loads the 3.3 core functions, pick up immutable texture storage where the driver has it
+            if (glfwExtensionSupported("GL_ARB_texture_storage"))
+                glad_glTexStorage2D = (PFNGLTEXSTORAGE2DPROC)glfwGetProcAddress("glTexStorage2D");
         }
 
         initialized = true;
         windowsOpen++;
         glfwSetWindowUserPointer(window, this);
         glfwSwapInterval(0);
+        int bufferWidth, bufferHeight;
+        glfwGetFramebufferSize(window, &bufferWidth, &bufferHeight);
+        BufferWidth = bufferWidth;
+        BufferHeight = bufferHeight;
+        renderTargets = std::make_unique<RenderTargetPool>(bufferWidth, bufferHeight);
         glfwSetWindowSizeCallback(window, [](GLFWwindow* window, int width, int height) {
             Window* self = (Window*)glfwGetWindowUserPointer(window);
             self->Width = width;
@@ -102,6 +120,7 @@ public:
             Window* self = (Window*)glfwGetWindowUserPointer(window);
             self->BufferWidth = width;
             self->BufferHeight = height;
+            self->renderTargets->resize(width, height);
             self->onResize(window, width, height);
         });
 
@@ -137,6 +156,8 @@ public:
         });
     }
     ~Window() {
+        // Targets hold GL objects so they go before the context does
+        renderTargets.reset();
         if (window != NULL)
             glfwDestroyWindow(window);
     }
@@ -165,6 +186,7 @@ public:
         glfwGetCursorPos(window, &mouseX, &mouseY);
         draw();
         clearReleased();
+        renderTargets->nextFrame();
         glfwSwapBuffers(window);
     }
 
@@ -234,47 +256,72 @@ public:
     std::unique_ptr<SoundLoader> sl;
     std::unique_ptr<ShaderLoader> shaderLoader;
     std::unique_ptr<TextureLoader> textureLoader;
+    std::unique_ptr<TextureUploader> uploader;
+    std::unique_ptr<HotReloader> hotReloader;
+    std::unique_ptr<ResourceManager> resources;
+    // Scene resolution, F toggles adaptive scaling and O/P step a fixed scale
+    std::unique_ptr<DynamicResolution> resolution;
     glm::mat4 example = glm::mat4(1.0);
     glm::mat4 texture = glm::mat4(1.0);
-    std::unique_ptr <SpriteRenderer> Render;
+    std::unique_ptr <SpriteBatchRenderer> Render;
     std::unique_ptr <TypeWriterRenderer> Texter;
-    std::shared_ptr <PerspectiveCamera> camera;
+    // Sprayed from the cursor while the left mouse button is held
+    std::unique_ptr<ParticleSystem> particles;
+    double lastUpdate = 0.0;
+    std::shared_ptr <OrthographicCamera> camera;
+    // Zoomed out overview in the top right corner, toggled with M
+    std::shared_ptr <OrthographicCamera> minimap;
+    bool showMinimap = true;
+    // Follows camera from further back along z, draws the scene instead of it while toggled with V
+    std::shared_ptr<PerspectiveCamera> perspective;
+    bool usePerspective = false;
     std::shared_ptr<Texture> TextTexture;
+    std::unique_ptr<Font> font;
     bool animate = true;
 
     DefaultWindow(string windowName, unsigned int w, unsigned int h) : Window(windowName, w, h) {
         shaderLoader = std::make_unique<ShaderLoader>();
         textureLoader = std::make_unique<TextureLoader>();
+        uploader = std::make_unique<TextureUploader>();
+        resolution = std::make_unique<DynamicResolution>(*renderTargets);
         soloud = std::make_unique<SoLoud::Soloud>();
         soloud->init();
-        camera = std::make_shared<PerspectiveCamera>();
-        camera->position.x = 1;
+        camera = std::make_shared<OrthographicCamera>();
+        camera->position.x = -1;
         camera->updateView();
+        minimap = std::make_shared<OrthographicCamera>();
+        minimap->zoom = 0.01f;
+        minimap->viewport = glm::vec4(0.75f, 0.75f, 0.25f, 0.25f);
+        minimap->updateView();
+        perspective = std::make_shared<PerspectiveCamera>();
         sl = std::make_unique<SoundLoader>(soloud);
         sl->load({
             {"resources/sounds/pickupCoin.wav", "coin"},
             {"resources/sounds/bookFlip2.ogg", "bookflip"}
         });
 
-        Font f { "resources/fonts/font.ttf" };
-        auto size = 60;
-        auto range = FontAtlas::GetRangeFromAlphabet(std::string("!~ "));
-        auto atlas = std::make_shared<FontAtlas>(&f, size, range);
-        atlas->outImage("resources/fonts/font.ttf");
-        auto t = atlas->generateTexture("resources/fonts/font.ttf");
-        TextTexture = std::shared_ptr<Texture>(t);
+        font = std::make_unique<Font>("resources/fonts/font.ttf");
+        // Distance field glyphs stay sharp at any scale so a small bake is enough
+        auto size = 32;
+        auto atlas = std::make_shared<GlyphCache>(font.get(), size, 512, 512, true);
+        TextTexture = atlas->texture;
 
         shaderLoader->load({
             {{"resources/shaders/image.vert", "resources/shaders/image.frag"}, "image"},
             {{"resources/shaders/triangle.vert", "resources/shaders/triangle.frag"}, "triangle"},
-            {{"resources/shaders/sprite.vert", "resources/shaders/sprite.frag"}, "sprite"},
-            {{"resources/shaders/text.vert", "resources/shaders/text.frag"}, "text"}
+            {{"resources/shaders/spriteArray.vert", "resources/shaders/spriteArray.frag"}, "spriteArray"},
+            {{"resources/shaders/spriteStatic.vert", "resources/shaders/spriteArray.frag"}, "spriteStatic"},
+            {{"resources/shaders/text.vert", "resources/shaders/text.frag"}, "text"},
+            {{"resources/shaders/particle.vert", "resources/shaders/particle.frag"}, "particle"}
         });
 
-        textureLoader->load({
+        textureLoader->stream({
             {"resources/images/wood.jpg", "wood"},
             {"resources/images/bg_layer4.png", "bg"}
-        });
+        }, *uploader);
+
+        hotReloader = std::make_unique<HotReloader>(RESOURCE_SOURCE_DIR, "resources", *shaderLoader, *textureLoader);
+        resources = std::make_unique<ResourceManager>(*textureLoader, *sl, *shaderLoader);
 
         glEnable(GL_DEPTH_TEST);
         if (animate) {
@@ -285,8 +332,11 @@ public:
         glEnable(GL_CULL_FACE);
 
         auto imageShader = *(shaderLoader->get("image"));
+        auto spriteArrayShader = *(shaderLoader->get("spriteArray"));
+        auto spriteStaticShader = *(shaderLoader->get("spriteStatic"));
         auto triangleShader = *(shaderLoader->get("triangle"));
         auto textShader = *(shaderLoader->get("text"));
+        auto particleShader = *(shaderLoader->get("particle"));
         auto bgTexture = *(textureLoader->get("bg"));
         auto woodTexture = *(textureLoader->get("wood"));
 
@@ -298,55 +348,31 @@ public:
                     0.5f, 0.5f,  // top right
                     0.5f, -0.5f,  // bottom right
                     -0.5f, 0.5f,  // top left 
-                    // second triangle
-                    0.5f, -0.5f,  // bottom right
                     -0.5f, -0.5f,  // bottom left
-                    -0.5f, 0.5f,   // top left
                 },
                 std::vector<float> {
                     1.0f, 1.0f,
                     1.0f, 0.0f,
                     0.0f, 1.0f,
-                    // second triangle
-                    1.0f, 0.0f,
-                    0.0f, 0.0f,
-                    0.0f, 1.0f
+                    0.0f, 0.0f
                 },
                 textShader,
                 TextTexture,
-                GL_STATIC_DRAW
+                GL_STATIC_DRAW,
+                Primitive::Quads
             ),
             atlas,
             camera
         );
 
-        Render = std::make_unique<SpriteRenderer>(std::make_unique<TexturedMesh>(
-            std::vector<float> {
-                0.5f, 0.5f,  // top right
-                0.5f, -0.5f,  // bottom right
-                -0.5f, 0.5f,  // top left 
-                // second triangle
-                0.5f, -0.5f,  // bottom right
-                -0.5f, -0.5f,  // bottom left
-                -0.5f, 0.5f,   // top left
-            },
-            std::vector<float> {
-                1.0f, 1.0f,
-                1.0f, 0.0f,
-                0.0f, 1.0f,
-                // second triangle
-                1.0f, 0.0f,
-                0.0f, 0.0f,
-                0.0f, 1.0f
-            },
-            imageShader,
-            bgTexture,
-            GL_STATIC_DRAW
-        ), camera);
+        // Sprite geometry comes from each texture's hull
+        Render = std::make_unique<SpriteBatchRenderer>(spriteArrayShader, std::make_shared<TextureArray>(512, 512, 8), camera, spriteStaticShader);
 
         Render->add(1, bgTexture, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f)));
         Render->add(2, woodTexture, glm::translate(glm::mat4(1.0f), glm::vec3(-1.25f, 0.0f, 0.0f)));
 
+        particles = std::make_unique<ParticleSystem>(particleShader);
+
         Texter->add(400, "Hello World pointer \n This is a better thing", glm::mat4(1.0f));
 
         std::random_device rd;
@@ -355,15 +381,22 @@ public:
         std::uniform_real_distribution<float> normal { 0.1, 1.0f };
         // std::normal_distribution normal {0.0f, 1.0f};
 
-        for (unsigned int i = 3; i < 500; ++i) {
-            float x = position(gen);
-            float y = position(gen);
-            float width = normal(gen);
-            float height = normal(gen);
-            bool texture = position(gen) > 0;
-            auto transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 1.0f));
-            transform = glm::scale(transform, glm::vec3(width, height, 1.0f));
-            Render->add(i, texture ? woodTexture : bgTexture, transform);
+        const std::size_t scattered = 497;
+        std::vector<float> xs(scattered), ys(scattered), depths(scattered, 1.0f), rotations(scattered, 0.0f);
+        std::vector<float> widths(scattered), heights(scattered);
+        std::vector<bool> woodTextured(scattered);
+        for (std::size_t i = 0; i < scattered; ++i) {
+            xs[i] = position(gen);
+            ys[i] = position(gen);
+            widths[i] = normal(gen);
+            heights[i] = normal(gen);
+            woodTextured[i] = position(gen) > 0;
+        }
+        std::vector<glm::mat4> transforms(scattered);
+        Transforms::compose({ xs.data(), ys.data(), depths.data(), rotations.data(), widths.data(), heights.data() }, scattered, transforms.data());
+        for (std::size_t i = 0; i < scattered; ++i) {
+            // The scattered background never moves, only the first two sprites animate
+            Render->add(RenderableId(i + 3), woodTextured[i] ? woodTexture : bgTexture, transforms[i], true);
         }
 
         exampleMesh = std::make_unique<Shape>(
@@ -371,32 +404,38 @@ public:
                 0.5f,  0.5f,  // top right
                 0.5f, -0.5f,  // bottom right
                 -0.5f,  0.5f, // top left 
-                // second triangle
-                0.5f, -0.5f,  // bottom right
                 -0.5f, -0.5f, // bottom left
-                -0.5f,  0.5f, // top left
             },
             triangleShader,
-            GL_STATIC_DRAW
+            GL_STATIC_DRAW,
+            Primitive::Quads
         );
     };
+    Camera& sceneCamera() {
+        if (usePerspective)
+            return *perspective;
+        return *camera;
+    }
+
     virtual void draw() {
         float red = (float)mouseX / Width;
-        glClearColor(0.1f, 0.4f, 0.5f, 1.0f);
+        glm::vec2 sceneSize = resolution->begin(BufferWidth, BufferHeight);
+        if (Render->overdraw)
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        else
+            glClearColor(0.1f, 0.4f, 0.5f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         float time = glfwGetTime();
 
         camera->updateProjectionMatrix(*this);
-        glm::vec4 mouse = glm::vec4(
-            Math::map(mouseX, 0.0f, Width, -1.0f, 1.0f), Math::map(mouseY, Height, 0.0f, -1.0f, 1.0f),
-            1.0f, 1.0f
-        );
+        minimap->updateProjectionMatrix(*this);
+        perspective->updateProjectionMatrix(*this);
+        Camera& view = sceneCamera();
         example = glm::scale(glm::identity<glm::mat4>(), glm::vec3(std::sin(time), std::sin(time), 5.0));
         
         exampleMesh->shader->use()->setUniform4f("color", red, 0.3, 0.4, 0.5)->setUniformMat4("model", example);
-        camera->applyToShader(*(exampleMesh->shader));
 
-        auto out = (glm::inverse(camera->projection * camera->view) * mouse);
+        auto out = view.screenToPlane(glm::vec2(mouseX, mouseY), 1.0f);
         if (animate) {
             auto& firstT = Render->entities[0].transform;
             auto& secondT = Render->entities[1].transform;
@@ -409,14 +448,45 @@ public:
             Text = glm::scale(Text, glm::vec3(std::cos(time), std::cos(time), 1.0f));
         }
 
-        Render->Render();
+        view.applyViewport(sceneSize);
+        Render->prepare();
+        Render->draw(view);
+        particles->draw(view);
+
+        // Both views share the sprite batch uploaded by prepare
+        if (showMinimap) {
+            minimap->applyViewport(sceneSize);
+            glEnable(GL_SCISSOR_TEST);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            Render->draw(*minimap);
+            glDisable(GL_SCISSOR_TEST);
+        }
+
+        // Text stays sharp at native resolution on top of the upscaled scene
+        resolution->end(BufferWidth, BufferHeight);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        camera->applyViewport(glm::vec2(BufferWidth, BufferHeight));
         Texter->Render();
     }
 
     virtual void update(GLFWwindow* window) {
         if (getKeyReleased(GLFW_KEY_R)) {
             cout << "Reload" << id << endl;
+            hotReloader->reloadAll();
         }
+        uploader->process();
+        hotReloader->apply();
+
+        double now = glfwGetTime();
+        // Long stalls, like dragging the window, shouldn't launch everything off screen
+        float dt = float(std::min(now - lastUpdate, 0.1));
+        lastUpdate = now;
+        if (getMouseDown(GLFW_MOUSE_BUTTON_1)) {
+            auto cursor = sceneCamera().screenToPlane(glm::vec2(mouseX, mouseY), particles->depth);
+            particles->emit(4000, glm::vec2(cursor.x, cursor.y), 1.0f, glm::vec4(1.0f, 0.6f, 0.2f, 0.8f), 2.0f);
+        }
+        particles->update(dt);
+        resources->collect();
         if (getKeyPressed(GLFW_KEY_ESCAPE)) {
             cout << "killing window" << id << endl;
             closeWindow();
@@ -425,42 +495,86 @@ public:
         float speed = 0.01;
 
         if (getKeyDown(GLFW_KEY_A)) {
-            camera->position.x += speed;
+            camera->position.x -= speed;
         }
 
         if (getKeyDown(GLFW_KEY_D)) {
-            camera->position.x -= speed;
+            camera->position.x += speed;
         }
 
         if (getKeyDown(GLFW_KEY_W)) {
-            camera->position.y += speed;
+            camera->position.y -= speed;
         }
 
         if (getKeyDown(GLFW_KEY_S)) {
-            camera->position.y -= speed;
+            camera->position.y += speed;
+        }
+
+        if (getKeyDown(GLFW_KEY_Q)) {
+            camera->rotation.z -= speed;
+        }
+
+        if (getKeyDown(GLFW_KEY_E)) {
+            camera->rotation.z += speed;
+        }
+
+        if (getKeyDown(GLFW_KEY_Z)) {
+            camera->zoom *= 1.0f + speed;
+        }
+
+        if (getKeyDown(GLFW_KEY_X)) {
+            camera->zoom /= 1.0f + speed;
         }
 
         if (getKeyReleased(GLFW_KEY_SPACE)) {
             animate = !animate;
         }
 
+        if (getKeyReleased(GLFW_KEY_M)) {
+            showMinimap = !showMinimap;
+        }
+
+        if (getKeyReleased(GLFW_KEY_V)) {
+            usePerspective = !usePerspective;
+            cout << (usePerspective ? "Perspective" : "Orthographic") << " camera" << endl;
+        }
+
+        if (getKeyReleased(GLFW_KEY_B)) {
+            Render->overdraw = !Render->overdraw;
+        }
+
+        if (getKeyReleased(GLFW_KEY_F)) {
+            resolution->adaptive = !resolution->adaptive;
+            cout << "Adaptive resolution " << (resolution->adaptive ? "on" : "off") << endl;
+        }
+
+        if (getKeyReleased(GLFW_KEY_O) || getKeyReleased(GLFW_KEY_P)) {
+            resolution->adaptive = false;
+            // Snapped to tenths so stepping back up lands on exactly full scale
+            float step = getKeyReleased(GLFW_KEY_P) ? 1.0f : -1.0f;
+            float scale = std::round(resolution->scale * 10.0f + step) / 10.0f;
+            resolution->scale = std::clamp(scale, resolution->minScale, resolution->maxScale);
+            cout << "Render scale " << resolution->scale << ", scene takes " << resolution->gpuMilliseconds() << " ms" << endl;
+        }
+
         camera->updateView();
+        // Two units behind the sprites at z 1 shows about as much as the orthographic camera
+        perspective->position = glm::vec3(camera->position.x, camera->position.y, 3.0f);
+        perspective->rotation = camera->rotation;
+        perspective->zoom = camera->zoom;
+        perspective->updateView();
 
         if (getMouseReleased(GLFW_MOUSE_BUTTON_1)) {
             cout << "Click!" << endl;
-            if (auto handle = sl->get("coin")) {
-                auto raw = (*handle).get();
-                soloud->play(*raw);
+            if (auto handle = sl->acquire("coin"_rid)) {
+                soloud->play(*handle);
             }
         }
 
-        Render->Render();
-
         if (getMouseReleased(GLFW_MOUSE_BUTTON_2)) {
             cout << "Clock!" << endl;
-            if (auto handle = sl->get("bookflip")) {
-                auto raw = (*handle).get();
-                soloud->play(*raw);
+            if (auto handle = sl->acquire("bookflip"_rid)) {
+                soloud->play(*handle);
             }
         }
 
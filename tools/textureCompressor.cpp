@@ -0,0 +1,61 @@
+// Offline encoder turning images into mipmapped BC1/BC3 .ktx files for CompressedTexture.
+// usage: textureCompressor <input image> <output.ktx> [bc1|bc3]
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "textureCompression.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cout << "usage: " << argv[0] << " <input image> <output.ktx> [bc1|bc3]" << std::endl;
+		return 1;
+	}
+	// Match the orientation ImageTexture loads with
+	stbi_set_flip_vertically_on_load(true);
+	int width, height, channels;
+	unsigned char* pixels = stbi_load(argv[1], &width, &height, &channels, 4);
+	if (!pixels) {
+		std::cout << "failed to load image " << argv[1] << std::endl;
+		return 1;
+	}
+
+	// Pick BC3 only when the image actually uses its alpha channel
+	auto format = TextureCompression::Format::BC1;
+	for (std::size_t i = 3; i < std::size_t(width) * height * 4; i += 4) {
+		if (pixels[i] < 255) {
+			format = TextureCompression::Format::BC3;
+			break;
+		}
+	}
+	if (argc > 3) {
+		std::string requested = argv[3];
+		if (requested == "bc1")
+			format = TextureCompression::Format::BC1;
+		else if (requested == "bc3")
+			format = TextureCompression::Format::BC3;
+		else {
+			std::cout << "unknown format " << requested << std::endl;
+			stbi_image_free(pixels);
+			return 1;
+		}
+	}
+
+	auto image = TextureCompression::compress(pixels, width, height, format);
+	stbi_image_free(pixels);
+	try {
+		TextureCompression::writeKtx(argv[2], image);
+	}
+	catch (const std::runtime_error& e) {
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+	std::size_t bytes = 0;
+	for (auto& level : image.levels) {
+		bytes += level.data.size();
+	}
+	std::cout << argv[2] << ": " << width << " x " << height << ", " << image.levels.size() << " levels, "
+		<< (format == TextureCompression::Format::BC1 ? "BC1" : "BC3") << ", " << bytes << " bytes" << std::endl;
+	return 0;
+}
@@ -0,0 +1,71 @@
+// Times Transforms::compose against the chained glm calls it replaces and checks they agree.
+// usage: transformBenchmark [count] [iterations]
+#include "transformBatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+	template<typename F>
+	double millisecondsPerRun(int iterations, F&& run) {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+			run();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / iterations;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 50;
+	if (count == 0 || iterations <= 0) {
+		std::cout << "usage: " << argv[0] << " [count] [iterations]" << std::endl;
+		return 1;
+	}
+
+	std::mt19937 gen{ 1 };
+	std::uniform_real_distribution<float> position{ -100.0f, 100.0f };
+	std::uniform_real_distribution<float> angle{ -50.0f, 50.0f };
+	std::uniform_real_distribution<float> scale{ 0.1f, 4.0f };
+	std::vector<float> x(count), y(count), z(count), rotation(count), scaleX(count), scaleY(count);
+	for (std::size_t i = 0; i < count; i++) {
+		x[i] = position(gen);
+		y[i] = position(gen);
+		z[i] = position(gen);
+		rotation[i] = angle(gen);
+		scaleX[i] = scale(gen);
+		scaleY[i] = scale(gen);
+	}
+	TransformArrays in{ x.data(), y.data(), z.data(), rotation.data(), scaleX.data(), scaleY.data() };
+
+	std::vector<glm::mat4> expected(count), actual(count);
+	double reference = millisecondsPerRun(iterations, [&]() { Transforms::composeReference(in, count, expected.data()); });
+	double batched = millisecondsPerRun(iterations, [&]() { Transforms::compose(in, count, actual.data()); });
+
+	// Relative to the scale so large sprites are held to the same number of significant digits
+	float worst = 0.0f;
+	for (std::size_t i = 0; i < count; i++) {
+		float size = std::max(scaleX[i], scaleY[i]);
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++) {
+				float error = std::abs(expected[i][column][row] - actual[i][column][row]);
+				worst = std::max(worst, column < 2 ? error / size : error);
+			}
+		}
+	}
+
+	std::cout << count << " transforms, " << iterations << " iterations" << std::endl;
+	std::cout << "glm chain: " << reference << " ms" << std::endl;
+	std::cout << "batched:   " << batched << " ms (" << reference / batched << "x)" << std::endl;
+	std::cout << "largest difference: " << worst << std::endl;
+	if (worst > 1e-5f) {
+		std::cout << "batched transforms disagree with glm" << std::endl;
+		return 1;
+	}
+	return 0;
+}